@@ -0,0 +1,337 @@
+#include "CServer.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <Mem_DB/sys_util.hpp>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_stop_signal(int) noexcept
+{
+    stop_requested = 1;
+}
+
+void set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    {
+        throw sys_error("fcntl");
+    }
+}
+
+}
+
+CServer::CServer(std::string socket_path, handler_type handler) noexcept
+    :socket_path(std::move(socket_path)), handler(std::move(handler)), idle_period(0), idle(nullptr), listen_fd(-1), epoll_fd(-1), connections({})
+{
+}
+
+CServer::~CServer()
+{
+    for (auto& [fd, con] : connections)
+    {
+        close(fd);
+    }
+    if (epoll_fd != -1)
+    {
+        close(epoll_fd);
+    }
+    if (listen_fd != -1)
+    {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+}
+
+void CServer::Set_Idle_Handler(std::chrono::milliseconds period, std::function<void()> idle) noexcept
+{
+    idle_period = period;
+    this->idle = std::move(idle);
+}
+
+void CServer::Run()
+{
+    struct sigaction sa {};
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    // no SA_RESTART so epoll_wait returns EINTR
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    m_listen();
+
+    epoll_event events[max_events];
+    const int timeout = idle ? static_cast<int>(idle_period.count()) : -1;
+    auto last_idle = std::chrono::steady_clock::now();
+    while (!stop_requested)
+    {
+        if (idle && std::chrono::steady_clock::now() - last_idle >= idle_period)
+        {
+            idle();
+            last_idle = std::chrono::steady_clock::now();
+        }
+        int n = epoll_wait(epoll_fd, events, max_events, timeout);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw sys_error("epoll_wait");
+        }
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd)
+            {
+                m_accept();
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end())
+            {
+                continue;
+            }
+            auto& con = it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN))
+            {
+                m_close(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLIN)
+            {
+                m_read(fd, con);
+            } else if (events[i].events & EPOLLOUT)
+            {
+                m_write(fd, con);
+            }
+        }
+    }
+}
+
+void CServer::m_listen()
+{
+    sockaddr_un addr {};
+    if (socket_path.size() >= sizeof(addr.sun_path))
+    {
+        throw std::runtime_error("Socket path " + socket_path + " is too long!");
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1)
+    {
+        throw sys_error("socket");
+    }
+    // leftover from a previous run
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1)
+    {
+        throw sys_error("bind " + socket_path);
+    }
+    if (listen(listen_fd, SOMAXCONN) == -1)
+    {
+        throw sys_error("listen");
+    }
+    set_nonblocking(listen_fd);
+
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1)
+    {
+        throw sys_error("epoll_create1");
+    }
+    epoll_event ev {};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) == -1)
+    {
+        throw sys_error("epoll_ctl");
+    }
+}
+
+void CServer::m_accept()
+{
+    while (true)
+    {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // EAGAIN - queue is empty, other errors are transient (EMFILE, ...)
+            return;
+        }
+        try {
+            set_nonblocking(fd);
+        }
+        catch (std::runtime_error&)
+        {
+            // only this client is refused, the others keep being served
+            close(fd);
+            continue;
+        }
+        epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+        {
+            close(fd);
+            continue;
+        }
+        connections.emplace(fd, Connection());
+    }
+}
+
+void CServer::m_read(int fd, Connection& con)
+{
+    char buffer[read_chunk];
+    bool eof = false;
+    while (true)
+    {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n > 0)
+        {
+            con.in.append(buffer, static_cast<size_t>(n));
+            // the rest stays in the socket, epoll is level triggered and reports it again
+            if (con.in.size() > max_line)
+            {
+                break;
+            }
+            continue;
+        }
+        if (n == 0)
+        {
+            eof = true;
+            break;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        m_close(fd);
+        return;
+    }
+    m_process(con, eof);
+    if (eof)
+    {
+        con.closing = true;
+    }
+    m_write(fd, con);
+}
+
+void CServer::m_process(Connection& con, bool eof)
+{
+    if (con.closing)
+    {
+        con.in.clear();
+        return;
+    }
+    // all complete lines are handled at once and the responses go out in one batch
+    size_t end = eof ? con.in.size() : con.in.rfind('\n');
+    if (end == std::string::npos)
+    {
+        if (con.in.size() > max_line)
+        {
+            con.out += "ERROR\nLine is too long!\n";
+            con.in.clear();
+            con.closing = true;
+        }
+        return;
+    }
+    if (!eof)
+    {
+        end++;
+    }
+    std::istringstream in(con.in.substr(0, end));
+    con.in.erase(0, end);
+    std::ostringstream out;
+    if (!handler(in, out))
+    {
+        con.closing = true;
+        con.in.clear();
+    }
+    con.out += out.str();
+}
+
+void CServer::m_write(int fd, Connection& con)
+{
+    while (con.out_pos < con.out.size())
+    {
+        ssize_t n = send(fd, con.out.data() + con.out_pos, con.out.size() - con.out_pos, MSG_NOSIGNAL);
+        if (n >= 0)
+        {
+            con.out_pos += static_cast<size_t>(n);
+            continue;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        m_close(fd);
+        return;
+    }
+    if (con.out_pos == con.out.size())
+    {
+        con.out.clear();
+        con.out_pos = 0;
+        if (con.closing)
+        {
+            m_close(fd);
+            return;
+        }
+    }
+    m_watch(fd, con);
+}
+
+void CServer::m_watch(int fd, Connection& con)
+{
+    // no more commands are read until the client takes its responses
+    bool writing = !con.out.empty();
+    if (writing == con.writing)
+    {
+        return;
+    }
+    epoll_event ev {};
+    ev.events = writing ? EPOLLOUT : EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == -1)
+    {
+        m_close(fd);
+        return;
+    }
+    con.writing = writing;
+}
+
+void CServer::m_close(int fd) noexcept
+{
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
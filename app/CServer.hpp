@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+
+#include <string>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <unordered_map>
+#include <chrono>
+
+// Single threaded epoll server on a Unix domain socket.
+// All clients are served by one handler, so the shared database needs no locking.
+class CServer
+{
+public:
+    // handler gets all complete lines received by one read and writes responses to out,
+    // returns false when the connection should be closed (EXIT)
+    using handler_type = std::function<bool(std::istream& in, std::ostream& out)>;
+
+    CServer(std::string socket_path, handler_type handler) noexcept;
+    CServer(const CServer&) = delete;
+    CServer& operator=(const CServer&) = delete;
+    ~CServer();
+
+    // idle is called at least every period, also when no client sends anything
+    void Set_Idle_Handler(std::chrono::milliseconds period, std::function<void()> idle) noexcept;
+
+    // blocks until SIGINT/SIGTERM, throws std::runtime_error when setup fails
+    void Run();
+
+private:
+    struct Connection
+    {
+        std::string in;
+        std::string out;
+        size_t out_pos = 0;
+        bool closing = false;
+        bool writing = false;
+    };
+
+    void m_listen();
+    void m_accept();
+    void m_read(int fd, Connection& con);
+    void m_process(Connection& con, bool eof);
+    void m_write(int fd, Connection& con);
+    void m_watch(int fd, Connection& con);
+    void m_close(int fd) noexcept;
+
+    static constexpr size_t read_chunk = 64 * 1024;
+    static constexpr size_t max_line = 1024 * 1024;
+    static constexpr int max_events = 64;
+
+    std::string socket_path;
+    handler_type handler;
+    std::chrono::milliseconds idle_period;
+    std::function<void()> idle;
+    int listen_fd;
+    int epoll_fd;
+    std::unordered_map<int, Connection> connections;
+};
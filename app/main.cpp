@@ -11,9 +11,13 @@
 #include <filesystem>
 #include <fstream>
 #include <exception>
+#include <cstring>
+#include <chrono>
 
 #include <Mem_DB/CMemory_Database.hpp>
 
+#include "CServer.hpp"
+
 using fspath = std::filesystem::path;
 
 
@@ -34,20 +38,24 @@ constexpr size_t pair_regex_value = 2;
 DB_variant_p parse_arg_p(std::string&& arg)
 {
     std::smatch match;
-    if (std::regex_search(arg, match, string_regex))
-    {
-        return DB_variant_p(match[1].str());
-    } else if (std::regex_search(arg, match, double_regex))
-    {
-        return DB_variant_p(std::stod(match[0].str()));
-    } else if (std::regex_search(arg, match, int_regex))
-    {
-        return DB_variant_p(std::stoi(match[0].str()));
-    } else
+    try {
+        if (std::regex_search(arg, match, string_regex))
+        {
+            return DB_variant_p(match[1].str());
+        } else if (std::regex_search(arg, match, double_regex))
+        {
+            return DB_variant_p(std::stod(match[0].str()));
+        } else if (std::regex_search(arg, match, int_regex))
+        {
+            return DB_variant_p(std::stoi(match[0].str()));
+        }
+    }
+    // stoi and stod throw logic errors on "-", "." or out of range numbers
+    catch (std::logic_error&)
     {
-        std::runtime_error ex(arg + "  is not valid [int|double|string]!");
-        throw ex;
     }
+    std::runtime_error ex(arg + "  is not valid [int|double|string]!");
+    throw ex;
 }
 
 DB_variant parse_arg(std::string&& arg)
@@ -100,10 +108,29 @@ enum class Directiv : size_t {
     AVERAGE,
     MIN,
     MAX,
+    TOP_K,
+    BOTTOM_K,
+    PAIR_PREFIX,
+    PAIR_PREFIX_GREATER,
+    PAIR_PREFIX_LESS,
+    MEMORY,
+    INSERT_TTL,
+    EXPIRE,
+    COMPRESS,
+    QUERY_KEY_EQUALS,
+    QUERY_KEY_GREATER,
+    QUERY_KEY_LESS,
+    QUERY_RESULT,
+    QUERY_DROP,
+    DISK_TIER,
+    APPROX_DISTINCT,
+    APPROX_QUANTILE,
+    IMPORT,
+    CACHE,
 };
 
 using enum Directiv;
-constexpr auto COMMANDS = { INSERT,DELETE,KEY_EQUALS,KEY_GREATER,KEY_LESS,FIND_VALUE,AVERAGE,MIN,MAX,EXIT };
+constexpr auto COMMANDS = { INSERT,DELETE,KEY_EQUALS,KEY_GREATER,KEY_LESS,FIND_VALUE,AVERAGE,MIN,MAX,TOP_K,BOTTOM_K,PAIR_PREFIX,PAIR_PREFIX_GREATER,PAIR_PREFIX_LESS,MEMORY,INSERT_TTL,EXPIRE,COMPRESS,QUERY_KEY_EQUALS,QUERY_KEY_GREATER,QUERY_KEY_LESS,QUERY_RESULT,QUERY_DROP,DISK_TIER,APPROX_DISTINCT,APPROX_QUANTILE,IMPORT,CACHE,EXIT };
 
 constexpr  std::string_view directiv_to_str(const Directiv& com) noexcept
 {
@@ -118,6 +145,25 @@ constexpr  std::string_view directiv_to_str(const Directiv& com) noexcept
     case AVERAGE:     return "AVERAGE";
     case MIN:         return "MIN";
     case MAX:         return "MAX";
+    case TOP_K:       return "TOP_K";
+    case BOTTOM_K:    return "BOTTOM_K";
+    case PAIR_PREFIX: return "PAIR_PREFIX";
+    case PAIR_PREFIX_GREATER: return "PAIR_PREFIX_GREATER";
+    case PAIR_PREFIX_LESS:    return "PAIR_PREFIX_LESS";
+    case MEMORY:      return "MEMORY";
+    case INSERT_TTL:  return "INSERT_TTL";
+    case EXPIRE:      return "EXPIRE";
+    case COMPRESS:    return "COMPRESS";
+    case QUERY_KEY_EQUALS:  return "QUERY_KEY_EQUALS";
+    case QUERY_KEY_GREATER: return "QUERY_KEY_GREATER";
+    case QUERY_KEY_LESS:    return "QUERY_KEY_LESS";
+    case QUERY_RESULT:      return "QUERY_RESULT";
+    case QUERY_DROP:        return "QUERY_DROP";
+    case DISK_TIER:   return "DISK_TIER";
+    case APPROX_DISTINCT: return "APPROX_DISTINCT";
+    case APPROX_QUANTILE: return "APPROX_QUANTILE";
+    case IMPORT:      return "IMPORT";
+    case CACHE:       return "CACHE";
     case EXIT:        return "EXIT";
     default:          return "UNKNOWN";
     }
@@ -220,6 +266,42 @@ Command loadCommand()
     return com;
 }
 
+CMemory_Database::operation to_operation(const Directiv& com) noexcept
+{
+    switch (com)
+    {
+    case KEY_GREATER:
+    case PAIR_PREFIX_GREATER:
+    case QUERY_KEY_GREATER: return CMemory_Database::operation::KEY_GREATER;
+    case KEY_LESS:
+    case PAIR_PREFIX_LESS:
+    case QUERY_KEY_LESS:    return CMemory_Database::operation::KEY_LESS;
+    default:          return CMemory_Database::operation::KEY_EQUALS;
+    }
+}
+
+size_t parse_count(const DB_variant& arg, const Directiv& com)
+{
+    if (const int* count = std::get_if<int>(&arg); count != nullptr && *count >= 0)
+    {
+        return static_cast<size_t>(*count);
+    }
+    std::string msg = "Count for ";
+    msg += directiv_to_str(com);
+    msg += " has to be non negative int!";
+    throw std::runtime_error(msg);
+}
+
+size_t parse_bytes(const DB_variant& arg, const Directiv& com)
+{
+    // budgets over 2 GB do not fit into int, so double is accepted too
+    if (const double* bytes = std::get_if<double>(&arg); bytes != nullptr && *bytes >= 0)
+    {
+        return static_cast<size_t>(*bytes);
+    }
+    return parse_count(arg, com);
+}
+
 void execute_command(std::ostream& out, CMemory_Database& db, const Command& com)
 {
     auto args = parse_Args(std::move(com.getArgs()));
@@ -238,6 +320,32 @@ void execute_command(std::ostream& out, CMemory_Database& db, const Command& com
         }
         std::visit([&](auto&& key, auto&& val) {out << db.Insert(key, val);}, args[0], args[i]);
         return;
+    case INSERT_TTL:
+    {
+        if (args.size() < 3)
+        {
+            throw std::runtime_error("Minimal number of arguments for INSERT_TTL is 3!");
+        }
+        const std::chrono::milliseconds ttl(parse_count(args[0], com.getDirectiv()));
+        for (i = 2;i < args.size() - 1;i++)
+        {
+            std::visit([&](auto&& key, auto&& val) {db.Insert(key, val);}, args[1], args[i]);
+        }
+        std::visit([&](auto&& key, auto&& val) {out << db.Insert(ttl, key, val);}, args[1], args[i]);
+        return;
+    }
+    case EXPIRE:
+        if (args.size() == 2)
+        {
+            const std::chrono::milliseconds ttl(parse_count(args[1], com.getDirectiv()));
+            std::visit([&](auto&& key) {out << db.Expire(key, ttl);}, args[0]);
+            return;
+        }
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected 2 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
     case DELETE:
         if (args.size() == 1)
         {
@@ -252,23 +360,92 @@ void execute_command(std::ostream& out, CMemory_Database& db, const Command& com
         return;
 
     case KEY_EQUALS:
+    case KEY_LESS:
+    case KEY_GREATER:
+        if (args.size() == 1 || args.size() == 2)
+        {
+            const auto op = to_operation(com.getDirectiv());
+            const size_t limit = args.size() == 2 ? parse_count(args[1], com.getDirectiv()) : CMemory_Database::no_limit;
+            std::visit([&](auto&& key) {out << db.Search_Key(key, op, limit);}, args[0]);
+            return;
+        }
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected 1 or 2 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
+    case PAIR_PREFIX:
+    case PAIR_PREFIX_GREATER:
+    case PAIR_PREFIX_LESS:
+        if (args.size() == 1 || args.size() == 2)
+        {
+            const auto op = to_operation(com.getDirectiv());
+            const size_t limit = args.size() == 2 ? parse_count(args[1], com.getDirectiv()) : CMemory_Database::no_limit;
+            std::visit([&](auto&& first) {
+                using T = std::decay_t<decltype(first)>;
+                if constexpr (std::same_as<T, Pair>)
+                {
+                    throw std::runtime_error("Prefix of a Pair can not be a Pair!");
+                } else
+                {
+                    out << db.Search_Pair_Prefix(first, op, limit);
+                }
+                }, args[0]);
+            return;
+        }
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected 1 or 2 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
+    case MEMORY:
         if (args.size() == 1)
         {
-            std::visit([&](auto&& key) {out << db.Search_Key(key, CMemory_Database::operation::KEY_EQUALS);}, args[0]);
+            db.Set_Memory_Budget(parse_bytes(args[0], com.getDirectiv()));
+        }
+        if (args.size() <= 1)
+        {
+            out << "OK" << std::endl;
+            out << "MEMORY - " << db.Memory_Usage();
+            if (db.Memory_Budget() != CMemory_Database::no_limit)
+            {
+                out << " / " << db.Memory_Budget();
+            }
+            out << " bytes" << std::endl;
             return;
         }
-        [[fallthrough]];
-    case KEY_LESS:
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected max 1 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
+    case QUERY_KEY_EQUALS:
+    case QUERY_KEY_GREATER:
+    case QUERY_KEY_LESS:
         if (args.size() == 1)
         {
-            std::visit([&](auto&& key) {out << db.Search_Key(key, CMemory_Database::operation::KEY_LESS);}, args[0]);
+            const auto op = to_operation(com.getDirectiv());
+            const auto id = std::visit([&](auto&& key) {return db.Register_Query(key, op);}, args[0]);
+            if (id == CMemory_Database::no_query)
+            {
+                throw std::runtime_error("Disk tier could not be read!");
+            }
+            out << "OK" << std::endl;
+            out << "QUERY - " << id << std::endl;
+            return;
+        }
+        [[fallthrough]];
+    case QUERY_RESULT:
+        if (args.size() == 1 && com.getDirectiv() == QUERY_RESULT)
+        {
+            out << db.Query_Result(parse_count(args[0], com.getDirectiv()));
             return;
         }
         [[fallthrough]];
-    case KEY_GREATER:
-        if (args.size() == 1)
+    case QUERY_DROP:
+        if (args.size() == 1 && com.getDirectiv() == QUERY_DROP)
         {
-            std::visit([&](auto&& key) {out << db.Search_Key(key, CMemory_Database::operation::KEY_GREATER);}, args[0]);
+            out << (db.Unregister_Query(parse_count(args[0], com.getDirectiv())) ? "OK" : "ERROR") << std::endl;
             return;
         }
         msg += "Wrong number of arguments for ";
@@ -276,170 +453,176 @@ void execute_command(std::ostream& out, CMemory_Database& db, const Command& com
         msg += " expected 1 got ";
         msg += std::to_string(args.size());
         throw std::runtime_error(msg);
-    case AVERAGE:
-    {
-        double sum = 0;
-        size_t count = 0;
-        if (args.size() == 0)
-        {
-            auto result = db.Find_Value([&](const DB_variant&, const DB_variant& value) {
-                bool ret = false;
-                std::visit([&](auto&& val) {
-                    using T = std::decay_t<decltype(val)>;
-                    if constexpr (std::is_arithmetic_v<T>)
-                    {
-                        sum += val;
-                        count++;
-                        ret = true;
-                    }
-                    }, value);
-                return ret;});
-            if (count == 0)
+    case CACHE:
+        if (args.size() <= 1)
+        {
+            if (args.size() == 1)
             {
-                out << "ERROR" << std::endl;
-                out << "No values is valid type" << std::endl;
-                return;
+                db.Set_Cache_Capacity(parse_bytes(args[0], com.getDirectiv()));
             }
+            const auto& cache = db.Result_Cache();
             out << "OK" << std::endl;
-            out << result.getLines() << " rows." << std::endl;
-            out << "AVERAGE - " << sum / count << std::endl;
+            out << "CACHE - " << cache.Hits() << " hits, " << cache.Misses() << " misses, "
+                << cache.Memory_Usage() << " / " << cache.Capacity() << " bytes" << std::endl;
             return;
         }
-        if (args.size() == 1)
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected max 1 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
+    case IMPORT:
+        if ((args.size() == 1 || args.size() == 2) && std::holds_alternative<std::string>(args[0]))
         {
-            std::visit([&](auto&& key) {
-                const auto result = db.Search_Key(key, CMemory_Database::operation::KEY_EQUALS);
-                const auto values = result.getValues();
-                for (const auto& value : values)
-                {
-                    std::visit([&](auto&& val) {
-                        using T = std::decay_t<decltype(val)>;
-                        if constexpr (std::is_arithmetic_v<T>)
-                        {
-                            sum += val;
-                            count++;
-                        }
-                        }, value);
-                }
-                if (count == 0)
-                {
-                    out << "ERROR" << std::endl;
-                    out << "No values is valid type" << std::endl;
-                    return;
-                }
-                out << "OK" << std::endl;
-                out << result.getLines() << " rows." << std::endl;
-                out << "AVERAGE - " << sum / count << std::endl;
-                }, args[0]);
+            const std::filesystem::path file(std::get<std::string>(args[0]));
+            const char delimiter = file.extension() == ".tsv" ? '\t' : ',';
+            const size_t threads = args.size() == 2 ? parse_count(args[1], com.getDirectiv()) : 0;
+            const auto start = std::chrono::steady_clock::now();
+            const size_t rows = db.Import(file, delimiter, threads);
+            const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+            out << "OK" << std::endl;
+            out << "IMPORT - " << rows << " rows in " << took.count() << " s" << std::endl;
             return;
         }
-    }
-    [[fallthrough]];
-    case MIN:
-    {
-        double min = std::numeric_limits<double>::max();
-        if (args.size() == 0)
-        {
-            auto result = db.Find_Value([&](const DB_variant&, const DB_variant& value) {
-                bool ret = false;
-                std::visit([&](auto&& val) {
-                    using T = std::decay_t<decltype(val)>;
-                    if constexpr (std::is_arithmetic_v<T>)
-                    {
-                        min = std::min(min, static_cast<double>(val));
-                        ret = true;
-                    }
-                    }, value);
-                return ret;});
+        msg += "Wrong arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected file as string and optional thread count got ";
+        msg += std::to_string(args.size());
+        msg += " arguments";
+        throw std::runtime_error(msg);
+    case APPROX_DISTINCT:
+        if (args.size() <= 1)
+        {
+            const double distinct = args.empty() ? db.Approx_Distinct() : std::visit([&](auto&& key) {return db.Approx_Distinct(key);}, args[0]);
+            if (std::isnan(distinct))
+            {
+                throw std::runtime_error("Disk tier could not be read!");
+            }
             out << "OK" << std::endl;
-            out << result.getLines() << " rows." << std::endl;
-            out << "MIN - " << min << std::endl;
+            out << "APPROX_DISTINCT - " << std::llround(distinct) << std::endl;
             return;
         }
-        if (args.size() == 1)
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected max 1 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
+    case APPROX_QUANTILE:
+        if (args.size() == 1 || args.size() == 2)
         {
-            std::visit([&](auto&& key) {
-                const auto result = db.Search_Key(key, CMemory_Database::operation::KEY_EQUALS);
-                const auto values = result.getValues();
-                if (values.size() == 0)
+            const double q = std::visit([](auto&& val) -> double {
+                using T = std::decay_t<decltype(val)>;
+                if constexpr (std::is_arithmetic_v<T>)
                 {
-                    out << "ERROR" << std::endl;
-                    out << "No values is valid type" << std::endl;
-                    return;
-                }
-                for (const auto& value : values)
+                    return static_cast<double>(val);
+                } else
                 {
-                    std::visit([&](auto&& val) {
-                        using T = std::decay_t<decltype(val)>;
-                        if constexpr (std::is_arithmetic_v<T>)
-                        {
-                            min = std::min(min, static_cast<double>(val));
-                        }
-                        }, value);
+                    return -1;
                 }
-                out << "OK" << std::endl;
-                out << result.getLines() << " rows." << std::endl;
-                out << "MIN - " << min << std::endl;
                 }, args[0]);
-            return;
-        }
-    }
-    [[fallthrough]];
-    case MAX:
-    {
-        double max = std::numeric_limits<double>::min();
-        if (args.size() == 0)
-        {
-            auto result = db.Find_Value([&](const DB_variant&, const DB_variant& value) {
-                bool ret = false;
-                std::visit([&](auto&& val) {
-                    using T = std::decay_t<decltype(val)>;
-                    if constexpr (std::is_arithmetic_v<T>)
-                    {
-                        max = std::max(max, static_cast<double>(val));
-                        ret = true;
-                    }
-                    }, value);
-                return ret;});
-            if (result.empty())
+            if (!(q >= 0 && q <= 1))
+            {
+                throw std::runtime_error("Quantile for APPROX_QUANTILE has to be a number from 0 to 1!");
+            }
+            const double quantile = args.size() == 1 ? db.Approx_Quantile(q) : std::visit([&](auto&& key) {return db.Approx_Quantile(key, q);}, args[1]);
+            if (std::isnan(quantile))
             {
                 out << "ERROR" << std::endl;
                 out << "No values is valid type" << std::endl;
                 return;
             }
             out << "OK" << std::endl;
-            out << result.getLines() << " rows." << std::endl;
-            out << "MAX - " << max << std::endl;
+            out << "APPROX_QUANTILE - " << quantile << std::endl;
+            return;
+        }
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected 1 or 2 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
+    case DISK_TIER:
+        if (args.size() == 1 && std::holds_alternative<std::string>(args[0]))
+        {
+            // throws std::filesystem_error when the directory cannot be created
+            if (!db.Set_Disk_Tier(std::make_unique<CDisk_tier>(std::get<std::string>(args[0]))))
+            {
+                throw std::runtime_error("Disk tier is already set!");
+            }
+            out << "OK" << std::endl;
             return;
         }
+        msg += "Wrong arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected directory as string got ";
+        msg += std::to_string(args.size());
+        msg += " arguments";
+        throw std::runtime_error(msg);
+    case COMPRESS:
         if (args.size() == 1)
         {
-            std::visit([&](auto&& key) {
-                const auto result = db.Search_Key(key, CMemory_Database::operation::KEY_EQUALS);
-                const auto values = result.getValues();
-                if (values.size() == 0)
-                {
-                    out << "ERROR" << std::endl;
-                    out << "No values is valid type" << std::endl;
-                    return;
-                }
-                for (const auto& value : values)
-                {
-                    std::visit([&](auto&& val) {
-                        using T = std::decay_t<decltype(val)>;
-                        if constexpr (std::is_arithmetic_v<T>)
-                        {
-                            max = std::max(max, static_cast<double>(val));
-                        }
-                        }, value);
-                }
-                out << "OK" << std::endl;
-                out << result.getLines() << " rows." << std::endl;
-                out << "MAX - " << max << std::endl;
-                }, args[0]);
+            db.Set_Compression_Threshold(parse_count(args[0], com.getDirectiv()));
+            out << "OK" << std::endl;
+            out << "COMPRESS - " << db.Compress(false) << " keys" << std::endl;
             return;
         }
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected 1 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
+    case TOP_K:
+    case BOTTOM_K:
+    {
+        const auto order = com.getDirectiv() == TOP_K ? CMemory_Database::rank::TOP : CMemory_Database::rank::BOTTOM;
+        if (args.size() == 1)
+        {
+            out << db.Top_K(parse_count(args[0], com.getDirectiv()), order);
+            return;
+        }
+        if (args.size() == 2)
+        {
+            const size_t k = parse_count(args[0], com.getDirectiv());
+            std::visit([&](auto&& key) {out << db.Top_K(key, k, order);}, args[1]);
+            return;
+        }
+        msg += "Wrong number of arguments for ";
+        msg += directiv_to_str(com.getDirectiv());
+        msg += " expected 1 or 2 got ";
+        msg += std::to_string(args.size());
+        throw std::runtime_error(msg);
     }
+    case AVERAGE:
+    case MIN:
+    case MAX:
+        if (args.size() <= 1)
+        {
+            const auto aggregate = args.empty() ? db.Aggregate_Values() : std::visit([&](auto&& key) {return db.Aggregate_Values(key);}, args[0]);
+            if (!aggregate.valid)
+            {
+                throw std::runtime_error("Disk tier could not be read!");
+            }
+            // over all keys only those with an arithmetic value count as rows
+            const size_t rows = args.empty() ? aggregate.arithmetic_rows : aggregate.rows;
+            // AVERAGE needs a number, MIN and MAX of a key any value and MAX over all keys a number
+            const bool empty = com.getDirectiv() == AVERAGE ? aggregate.arithmetic_values == 0
+                : args.empty() ? com.getDirectiv() == MAX && aggregate.arithmetic_values == 0
+                : aggregate.values == 0;
+            if (empty)
+            {
+                out << "ERROR" << std::endl;
+                out << "No values is valid type" << std::endl;
+                return;
+            }
+            out << "OK" << std::endl;
+            out << rows << " rows." << std::endl;
+            switch (com.getDirectiv())
+            {
+            case AVERAGE: out << "AVERAGE - " << aggregate.sum / static_cast<double>(aggregate.arithmetic_values) << std::endl; break;
+            case MIN:     out << "MIN - " << aggregate.min << std::endl; break;
+            default:      out << "MAX - " << aggregate.max << std::endl; break;
+            }
+            return;
+        }
     msg += "Wrong number of arguments for ";
     msg += directiv_to_str(com.getDirectiv());
     msg += " expected max 1 got ";
@@ -452,13 +635,62 @@ void execute_command(std::ostream& out, CMemory_Database& db, const Command& com
     }
 }
 
+bool serve_commands(std::istream& in, std::ostream& out, CMemory_Database& db)
+{
+    std::string line;
+    while (in >> line)
+    {
+        std::istringstream line_stream(line);
+        auto com = parseCommand(line_stream);
+        if (com.getDirectiv() == EXIT)
+        {
+            return false;
+        }
+        try {
+            if (com.getDirectiv() == UNKNOWN)
+            {
+                throw std::runtime_error("Unknow command " + line);
+            }
+            execute_command(out, db, com);
+        }
+        // one bad line of a client must not take the server down for the others
+        catch (std::exception& e)
+        {
+            out << "ERROR" << std::endl << e.what() << std::endl;
+        }
+    }
+    return true;
+}
+
 int main(int argc, char** argv)
 {
     CMemory_Database database;
-    if (argc < 3)
+    if (argc == 3 && std::string_view(argv[1]) == "--server")
+    {
+        CServer server(argv[2], [&](std::istream& in, std::ostream& out) {return serve_commands(in, out, database);});
+        size_t idle_rounds = 0;
+        server.Set_Idle_Handler(std::chrono::milliseconds(100), [&]() {
+            database.Collect_Expired();
+            // keys not written for the last 10 s count as cold
+            if (++idle_rounds % 100 == 0)
+            {
+                database.Compress(true);
+            }
+            });
+        try {
+            server.Run();
+        }
+        catch (std::runtime_error& e)
+        {
+            std::cerr << "ERROR" << std::endl << e.what() << std::endl << "exiting" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Done" << std::endl;
+    } else if (argc < 3)
     {
         std::cout << "Welcome in KIV/CPP semestral work - memory database.\n"
             "You can also run commands from file via runnig program with this set of arguments: <inputfile> <outputfile>\n"
+            "or serve many local clients via running program with: --server <socketpath>\n"
             "Please, enter your query after this (>) symbol." << std::endl;
         try {
         auto com = loadCommand();
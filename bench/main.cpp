@@ -0,0 +1,109 @@
+#include <cstdlib>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <functional>
+
+#include <Mem_DB/CMemory_Database.hpp>
+#include <Mem_DB/CTyped_database.hpp>
+
+// Dynamic CMemory_Database against CTyped_database on the same operations,
+// run with the number of keys as the only argument (default 200000).
+
+namespace {
+
+double measure(const std::function<void()>& run)
+{
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    const std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+    return took.count();
+}
+
+void report(const std::string& name, double dynamic, double typed)
+{
+    std::cout << std::left << std::setw(28) << name << std::right
+        << std::setw(12) << std::fixed << std::setprecision(1) << dynamic
+        << std::setw(12) << typed
+        << std::setw(10) << std::setprecision(2) << dynamic / typed << "x" << std::endl;
+}
+
+template<typename Key, typename Value, typename Make_key, typename Make_value>
+void run_schema(const std::string& schema, size_t keys, Make_key make_key, Make_value make_value, const Value& rare)
+{
+    using operation = CMemory_Database::operation;
+    std::mt19937 rng(42);
+    std::vector<Key> inserted;
+    std::vector<Value> values;
+    inserted.reserve(keys);
+    values.reserve(keys);
+    for (size_t i = 0; i < keys; i++)
+    {
+        inserted.push_back(make_key(rng));
+        values.push_back(make_value(rng));
+    }
+
+    CMemory_Database dynamic;
+    CTyped_database<Key, Value> typed;
+    std::cout << schema << std::endl;
+    std::cout << std::left << std::setw(28) << "operation" << std::right
+        << std::setw(12) << "dynamic ms" << std::setw(12) << "typed ms" << std::setw(11) << "speedup" << std::endl;
+
+    report("Insert",
+        measure([&] {for (size_t i = 0; i < keys; i++) dynamic.Insert(inserted[i], values[i]);}),
+        measure([&] {for (size_t i = 0; i < keys; i++) typed.Insert(inserted[i], values[i]);}));
+
+    size_t found_dynamic = 0;
+    size_t found_typed = 0;
+    report("Search_Key KEY_EQUALS",
+        measure([&] {for (const auto& key : inserted) found_dynamic += dynamic.Search_Key(key, operation::KEY_EQUALS).getLines();}),
+        measure([&] {for (const auto& key : inserted) found_typed += typed.Search_Key(key, operation::KEY_EQUALS).getLines();}));
+
+    const size_t ranges = keys / 10;
+    report("Search_Key KEY_GREATER 10",
+        measure([&] {for (size_t i = 0; i < ranges; i++) found_dynamic += dynamic.Search_Key(inserted[i], operation::KEY_GREATER, 10).getLines();}),
+        measure([&] {for (size_t i = 0; i < ranges; i++) found_typed += typed.Search_Key(inserted[i], operation::KEY_GREATER, 10).getLines();}));
+
+    report("Find_Value",
+        measure([&] {
+            for (int round = 0; round < 10; round++)
+            {
+                found_dynamic += dynamic.Find_Value([&](const DB_variant&, const DB_variant& value) {return value == DB_variant(rare);}).getLines();
+            }
+            }),
+        measure([&] {
+            for (int round = 0; round < 10; round++)
+            {
+                found_typed += typed.Find_Value([&](const Key&, const Value& value) {return value == rare;}).getLines();
+            }
+            }));
+
+    if (found_dynamic != found_typed)
+    {
+        std::cerr << "results differ: " << found_dynamic << " != " << found_typed << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    std::cout << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const size_t keys = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+    run_schema<int, double>("int -> double", keys,
+        [](std::mt19937& rng) {return static_cast<int>(rng() % 1000000000);},
+        [](std::mt19937& rng) {return static_cast<double>(rng() % 1000) / 10;},
+        1.5);
+
+    run_schema<std::string, int>("string -> int", keys,
+        [](std::mt19937& rng) {return "key" + std::to_string(rng());},
+        [](std::mt19937& rng) {return static_cast<int>(rng() % 1000);},
+        7);
+    return 0;
+}
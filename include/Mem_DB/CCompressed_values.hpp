@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <vector>
+#include <string>
+
+#include <Mem_DB/p_types.hpp>
+
+// Compact read only form of a value vector. Consecutive values of one type form a run:
+// int runs are delta + zigzag encoded and bit packed in blocks, string runs are
+// bit packed indices into a dictionary, doubles and Pairs are stored as they are.
+class CCompressed_values
+{
+public:
+    static constexpr size_t block_size = 128;
+
+    explicit CCompressed_values(const std::vector<DB_variant>& values);
+
+    // sequential decoder, hands out at most one block at a time
+    class Decoder
+    {
+    public:
+        explicit Decoder(const CCompressed_values& data) noexcept
+            :data(data), run(0), done(0), int_pos(0), code_pos(0), double_pos(0), other_pos(0), previous(0) {};
+
+        // decodes up to block_size values into out, returns 0 at the end
+        size_t Next(DB_variant* out);
+
+    private:
+        const CCompressed_values& data;
+        size_t run;
+        size_t done;
+        size_t int_pos;
+        size_t code_pos;
+        size_t double_pos;
+        size_t other_pos;
+        int64_t previous;
+    };
+
+    template<typename F>
+    void For_Each(F&& func) const
+    {
+        std::array<DB_variant, block_size> buffer;
+        Decoder decoder(*this);
+        for (size_t n = decoder.Next(buffer.data()); n != 0; n = decoder.Next(buffer.data()))
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                func(buffer[i]);
+            }
+        }
+    }
+
+    std::vector<DB_variant> Decode() const;
+
+    inline size_t size() const noexcept
+    {
+        return count;
+    }
+
+    // bytes allocated by this object including itself
+    inline size_t Memory_Usage() const noexcept
+    {
+        return bytes;
+    }
+
+private:
+    enum class kind : uint8_t
+    {
+        INT,
+        DOUBLE,
+        STRING,
+        OTHER
+    };
+
+    struct Run
+    {
+        kind type;
+        size_t length;
+    };
+
+    size_t count;
+    size_t bytes;
+    std::vector<Run> runs;
+    // per block one word with the bit width followed by the packed words
+    std::vector<uint64_t> ints;
+    std::vector<uint64_t> codes;
+    std::vector<double> doubles;
+    std::vector<std::string> dictionary;
+    std::vector<DB_variant> others;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+#include <string_view>
+#include <vector>
+#include <filesystem>
+
+#include <Mem_DB/p_types.hpp>
+
+// CSV/TSV file mapped into memory, one record per line: key followed by its values.
+// Fields are int or double when they parse as a whole, otherwise strings;
+// quoted fields are always strings and may contain the delimiter, but not a line break.
+class CCsv_import
+{
+public:
+    struct Row
+    {
+        DB_variant key;
+        std::vector<DB_variant> values;
+    };
+
+    // throws std::runtime_error when the file cannot be mapped
+    CCsv_import(const std::filesystem::path& file, char delimiter = ',');
+    CCsv_import(const CCsv_import&) = delete;
+    CCsv_import& operator=(const CCsv_import&) = delete;
+    ~CCsv_import();
+
+    // the file is split at line boundaries, every thread returns its rows stably sorted by key,
+    // batches are in file order; an exception of any thread is rethrown after all of them finished
+    std::vector<std::vector<Row>> Parse(size_t threads) const;
+
+    static void Parse_Line(std::string_view line, char delimiter, std::vector<DB_variant>& fields);
+
+    inline size_t size() const noexcept
+    {
+        return length;
+    }
+
+private:
+    static DB_variant m_field(std::string_view field) noexcept;
+    void m_parse_chunk(size_t begin, size_t end, std::vector<Row>& rows) const;
+
+    const char* data;
+    size_t length;
+    char delimiter;
+};
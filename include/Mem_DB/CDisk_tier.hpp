@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <functional>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <Mem_DB/CSorted_run.hpp>
+
+// LSM style spill space of a database. Every flush writes one immutable sorted run,
+// a background thread merges runs of similar size (size tiered), so every item is
+// rewritten O(log n) times. Runs live only as long as the tier, it is not a persistent store.
+class CDisk_tier
+{
+public:
+    using item_type = CSorted_run::Item;
+    // returns false to stop the scan
+    using visitor_type = std::function<bool(item_type&& item)>;
+
+    explicit CDisk_tier(std::filesystem::path directory, size_t compaction_trigger = 4);
+    CDisk_tier(const CDisk_tier&) = delete;
+    CDisk_tier& operator=(const CDisk_tier&) = delete;
+    ~CDisk_tier();
+
+    // items have to be sorted by key, they shadow older versions of the same keys
+    void Flush(const std::vector<item_type>& items);
+
+    // newest version of the key, runs whose Bloom filter rules the key out are not read
+    std::optional<item_type> Get(const DB_variant& key) const;
+
+    // newest version of every key from low on in key order
+    void Scan(const DB_variant& low, bool inclusive, const visitor_type& visit) const;
+
+    size_t Runs() const noexcept;
+
+    // current tick of the database, compaction drops the items expired by then
+    inline void Advance(uint64_t now) noexcept
+    {
+        this->now.store(now, std::memory_order_relaxed);
+    }
+
+private:
+    using run_list = std::vector<std::shared_ptr<CSorted_run>>;
+
+    // runs up to this size are all in the lowest tier, every next tier is trigger times larger
+    static constexpr uint64_t tier_base = 64 * 1024;
+
+    static void m_merge(const run_list& merged, const DB_variant* low, bool inclusive, const visitor_type& visit);
+    // [first, last) of runs to merge, empty when no tier has trigger runs next to each other
+    std::pair<size_t, size_t> m_pick(const run_list& list) const noexcept;
+    run_list m_snapshot() const noexcept;
+    std::string m_next_path();
+    void m_compact_loop();
+
+    std::filesystem::path directory;
+    size_t trigger;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    // newest run first
+    run_list runs;
+    size_t next_id;
+    size_t failed_runs;
+    bool stopping;
+    std::atomic<uint64_t> now;
+    std::thread compactor;
+};
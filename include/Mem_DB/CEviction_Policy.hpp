@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+#include <random>
+
+#include <Mem_DB/p_types.hpp>
+
+// Chooses which key is removed when the memory budget of a database is exceeded.
+// Keys are referred to by handles so that touching a key on a read is O(1).
+class CEviction_Policy
+{
+public:
+    using handle_type = size_t;
+    static constexpr handle_type no_handle = static_cast<handle_type>(-1);
+
+    virtual ~CEviction_Policy() = default;
+
+    // key has to stay valid until Remove is called with the returned handle
+    virtual handle_type Add(const DB_variant* key) = 0;
+    virtual void Touch(handle_type handle) noexcept = 0;
+    virtual void Remove(handle_type handle) noexcept = 0;
+    // key which should be evicted next, never the key of keep, nullptr when there is none
+    virtual const DB_variant* Victim(handle_type keep) noexcept = 0;
+};
+
+// CLOCK (second chance) approximation of LRU, one reference bit per key
+class CClock_Policy : public CEviction_Policy
+{
+public:
+    CClock_Policy() noexcept :keys({}), referenced({}), free({}), hand(0), live(0) {};
+
+    handle_type Add(const DB_variant* key) override;
+    void Touch(handle_type handle) noexcept override
+    {
+        referenced[handle] = 1;
+    }
+    void Remove(handle_type handle) noexcept override;
+    const DB_variant* Victim(handle_type keep) noexcept override;
+
+private:
+    std::vector<const DB_variant*> keys;
+    std::vector<uint8_t> referenced;
+    std::vector<handle_type> free;
+    size_t hand;
+    size_t live;
+};
+
+// approximate LRU, evicts the least recently used key out of a few random samples
+class CSampled_LRU_Policy : public CEviction_Policy
+{
+public:
+    explicit CSampled_LRU_Policy(size_t samples = 5) noexcept :samples(samples), clock(0), slots({}), index({}), free({}), rng() {};
+
+    handle_type Add(const DB_variant* key) override;
+    void Touch(handle_type handle) noexcept override
+    {
+        slots[index[handle]].last_access = ++clock;
+    }
+    void Remove(handle_type handle) noexcept override;
+    const DB_variant* Victim(handle_type keep) noexcept override;
+
+private:
+    struct Slot
+    {
+        const DB_variant* key;
+        uint64_t last_access;
+        handle_type handle;
+    };
+
+    size_t samples;
+    uint64_t clock;
+    // live keys are kept dense so that sampling never hits a hole
+    std::vector<Slot> slots;
+    std::vector<size_t> index;
+    std::vector<handle_type> free;
+    std::minstd_rand rng;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <cmath>
 
 #include <concepts>
 #include <map>
@@ -9,9 +10,22 @@
 #include <algorithm>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <utility>
+#include <memory>
+#include <chrono>
+#include <optional>
+#include <array>
 
 #include <Mem_DB/p_types.hpp>
 #include <Mem_DB/Result_type.hpp>
+#include <Mem_DB/CEviction_Policy.hpp>
+#include <Mem_DB/CTimer_Wheel.hpp>
+#include <Mem_DB/CCompressed_values.hpp>
+#include <Mem_DB/CDisk_tier.hpp>
+#include <Mem_DB/CSketch.hpp>
+#include <Mem_DB/CCsv_import.hpp>
+#include <Mem_DB/CResult_cache.hpp>
 
 
 template<typename T>
@@ -19,8 +33,54 @@ concept text = std::convertible_to<std::string, T> || std::same_as<const char*,
 class CMemory_Database
 {
 private:
-    using base_type = std::map<DB_variant, std::vector<DB_variant>>;
+    struct Entry
+    {
+        std::vector<DB_variant> values;
+        // heap bytes owned by values (strings), kept so accounting is O(1) per write
+        size_t heap = 0;
+        CEviction_Policy::handle_type handle = CEviction_Policy::no_handle;
+        // millisecond tick since the database was created, the key is absent from this tick on
+        CTimer_Wheel::tick_type expires = no_expiry;
+        // set for large cold keys, values are empty then
+        std::unique_ptr<CCompressed_values> compressed = nullptr;
+        // written since the last Compress
+        bool written = true;
+        // an older version may still be in the disk tier
+        bool on_disk = false;
+        // kept only for keys with at least key_sketch_threshold values
+        std::unique_ptr<CValue_sketch> sketch = nullptr;
+    };
+
+    static constexpr size_t key_sketch_threshold = 64;
+    static constexpr unsigned key_sketch_precision = 10;
+    static constexpr size_t key_sketch_k = 100;
+
+    static constexpr CTimer_Wheel::tick_type no_expiry = std::numeric_limits<CTimer_Wheel::tick_type>::max();
+
+    using base_type = std::map<DB_variant, Entry>;
     base_type base;
+    size_t memory;
+    size_t budget;
+    std::unique_ptr<CEviction_Policy> policy;
+    CTimer_Wheel timers;
+    std::chrono::steady_clock::time_point epoch;
+    size_t compression_threshold;
+    std::unique_ptr<CDisk_tier> tier;
+    // values of all keys; removed values stay counted until a quarter of the sketched
+    // ones are gone, then the next read builds it again, so the rebuilds are O(1) per removal
+    static constexpr uint64_t sketch_rebuild_ratio = 4;
+    mutable CValue_sketch sketch;
+    mutable uint64_t sketch_values;
+    mutable uint64_t sketch_removed;
+    // write epochs, every write stamps its key type (section) and a bucket of keys by hash
+    static constexpr size_t epoch_buckets = 1024;
+    uint64_t write_epoch;
+    std::array<uint64_t, std::variant_size_v<DB_variant>> section_epochs;
+    std::array<uint64_t, epoch_buckets> key_epochs;
+    // results of repeated reads, off until Set_Cache_Capacity gives it a size
+    mutable CResult_cache cache;
+    // earliest expiry of the keys visited since the cache reset it, a cached read is valid until then
+    mutable CTimer_Wheel::tick_type visit_expires;
 
 public:
 
@@ -31,6 +91,35 @@ public:
         KEY_LESS
     };
 
+    enum class rank
+    {
+        TOP,
+        BOTTOM
+    };
+
+    static constexpr size_t no_limit = std::numeric_limits<size_t>::max();
+
+    using query_id = size_t;
+
+    static constexpr query_id no_query = std::numeric_limits<query_id>::max();
+
+    enum class change_kind
+    {
+        ADDED,
+        REMOVED
+    };
+
+    // one value added to or removed from the result of a registered query
+    struct Change
+    {
+        change_kind kind;
+        DB_variant key;
+        DB_variant value;
+    };
+
+    // called synchronously from the write, must not modify the database
+    using subscriber_type = std::function<void(const Change& change)>;
+
     constexpr bool compare(auto&& order, const operation& op) const noexcept
     {
         using enum operation;
@@ -47,25 +136,49 @@ public:
     }
 
 
-    CMemory_Database() noexcept : base(base_type()) {};
+    CMemory_Database() noexcept : base(base_type()), memory(0), budget(no_limit), policy(nullptr), timers(), epoch(std::chrono::steady_clock::now()), compression_threshold(no_limit), tier(nullptr), sketch(), sketch_values(0), sketch_removed(0), write_epoch(0), section_epochs({}), key_epochs({}), cache(), visit_expires(no_expiry), queries({}), next_query(0) {};
 
     template<DB_type key_type, DB_type... Vals>
     Result_type Insert(key_type key, Vals... values) noexcept
     {
         Result_type result;
-        auto& vect = base[key];
-        m_insert(vect, values...);
-        result.add(key, vect);
+        Collect_Expired();
+        auto it = m_entry(to_variant(key));
+        m_insert(it, values...);
+        result.add(Record(it->first, it->second.values));
+        m_enforce_budget(it);
+        return result;
+    }
+
+    // key with the values expires after ttl
+    template<DB_type key_type, DB_type... Vals>
+    Result_type Insert(std::chrono::milliseconds ttl, key_type key, Vals... values) noexcept
+    {
+        auto result = Insert(key, values...);
+        m_expire(to_variant(key), ttl);
         return result;
     }
 
+    // sets the time to live of an existing key, invalid result if the key is absent
+    template<DB_type key_type>
+    Result_type Expire(key_type key, std::chrono::milliseconds ttl) noexcept
+    {
+        Collect_Expired();
+        return m_expire(to_variant(key), ttl);
+    }
+
+    // removes keys whose time to live has passed, returns their count,
+    // runs on every write and should run periodically when there are none
+    size_t Collect_Expired() noexcept;
+
     template<DB_type key_type>
     Result_type Delete(key_type key) noexcept
     {
         Result_type result;
-        //auto& vect = base[key];
-        base[key] = {};
-        result.add(key, base[key]);
+        Collect_Expired();
+        auto it = m_entry(to_variant(key));
+        m_clear(it);
+        result.add(Record(it->first, it->second.values));
         return result;
     }
 
@@ -73,101 +186,435 @@ public:
     Result_type Delete(key_type key, V... values) noexcept
     {
         Result_type result;
-        auto& vect = base[key];
-        m_delete(vect, values...);
-        result.add(key, vect);
+        Collect_Expired();
+        auto it = m_entry(to_variant(key));
+        m_delete(it, values...);
+        result.add(Record(it->first, it->second.values));
         return result;
     }
 
+    // bytes used by keys, value vectors, strings and map nodes
+    inline size_t Memory_Usage() const noexcept
+    {
+        return memory;
+    }
+
+    inline size_t Memory_Budget() const noexcept
+    {
+        return budget;
+    }
+
+    // no_limit turns the budget off, a CLOCK policy is installed if none was set;
+    // with a disk tier the evicted keys are spilled to it instead of being removed
+    void Set_Memory_Budget(size_t bytes) noexcept;
+
+    // only one tier can be set, returns false if there already is one
+    bool Set_Disk_Tier(std::unique_ptr<CDisk_tier> new_tier) noexcept;
+
+    inline const CDisk_tier* Disk_Tier() const noexcept
+    {
+        return tier.get();
+    }
+
+    void Set_Eviction_Policy(std::unique_ptr<CEviction_Policy> new_policy) noexcept;
+
+    // keys with at least this many values may be compressed, no_limit turns compression off
+    inline void Set_Compression_Threshold(size_t values) noexcept
+    {
+        compression_threshold = values;
+    }
+
+    inline size_t Compression_Threshold() const noexcept
+    {
+        return compression_threshold;
+    }
+
+    // compresses keys over the threshold, with cold_only only those not written since the
+    // previous call; returns the number of compressed keys, a write decompresses the key again
+    size_t Compress(bool cold_only) noexcept;
+
+    // the reads below give an invalid result when a run of the disk tier cannot be read,
+    // they go through the result cache
     template<DB_type key_type>
-    Result_type Search_Key(const key_type& key, const operation& op) const noexcept
+    Result_type Search_Key(const key_type& key, const operation& op, size_t limit = no_limit) const noexcept
     {
-        Result_type result;
-        for (const auto& [key_v, values] : base)
-        {
-            if constexpr (std::is_arithmetic_v<key_type>)
-            {
-                std::visit(visitors{
-                        [&](const int& i) {
-                            if (compare(i <=> key,op))
-                            {
-                                result.add(i,values);
-                            }
-                         },
-                        [&](const double& d) {
-                            if (compare(d <=> key,op))
-                            {
-                                result.add(d,values);
-                            }
-                        },
-                        [&](const auto&) {/*not comparable*/},
-                        [&](const Pair&) {/*not comparable*/}
-                    }, key_v);
-            } else if constexpr (std::is_convertible_v<key_type, std::string>)
-            {
-                std::visit(visitors{
-                        [&](const int&) {/*not comparable*/},
-                        [&](const double&) {/*not comparable*/},
-                        [&](const std::string& s) {
-                            if (compare(key <=> s,op))
-                            {
-                                result.add(s,values);
-                            }
-                         },
-                         [&](const Pair&) {/*not comparable*/}
-                    }, key_v);
-            } else if constexpr (std::derived_from<key_type, Pair>)
-            {
-                std::visit(visitors{
-                        [&](const int&) {/*not comparable*/},
-                        [&](const double&) {/*not comparable*/},
-                        [&](const std::string&) {/*not comparable*/},
-                        [&](const Pair& p) {
-                            if (compare(key <=> p,op))
-                            {
-                                result.add(p,values);
-                            }
-                         }
-                    }, key_v);
-            } else
-            {
-                assert(false && "unreachable");
-            }
-        }
-        return result;
+        const DB_variant probe = to_variant(key);
+        const auto bounds = m_key_bounds(probe, op);
+        return m_cached<Result_type>(m_read_key(read_kind::SEARCH, &probe, static_cast<int>(op), limit), m_epoch(bounds), [&] {return m_search(bounds, limit);},
+            [&](const Result_type& result) {m_touch_rows(result);});
+    }
+
+    // Pair keys whose first component is selected as Search_Key selects Pair keys: KEY_GREATER
+    // gives the first components less than first and KEY_LESS the greater ones;
+    // int and double are compared with each other, strings only with strings
+    template<DB_type_primitive first_type>
+    Result_type Search_Pair_Prefix(const first_type& first, const operation& op, size_t limit = no_limit) const noexcept
+    {
+        const DB_variant probe = to_variant(first);
+        const auto bounds = m_pair_bounds(to_variant_p(first), op);
+        return m_cached<Result_type>(m_read_key(read_kind::PAIR_PREFIX, &probe, static_cast<int>(op), limit), m_epoch(bounds), [&] {return m_search(bounds, limit);},
+            [&](const Result_type& result) {m_touch_rows(result);});
     }
 
+    // 0 turns the cache off and drops what it holds
+    inline void Set_Cache_Capacity(size_t bytes) noexcept
+    {
+        cache.Set_Capacity(bytes);
+    }
 
+    inline const CResult_cache& Result_Cache() const noexcept
+    {
+        return cache;
+    }
+
+    // grows with every write that can change the result of a read (Collect_Expired included),
+    // an unchanged epoch means a cached read result is still valid
+    inline uint64_t Write_Epoch() const noexcept
+    {
+        return write_epoch;
+    }
+
+    // same for Search_Key(key, op) only, ranges are tracked per key type and single keys by hash bucket,
+    // so writes elsewhere rarely change it
+    template<DB_type key_type>
+    uint64_t Write_Epoch(const key_type& key, const operation& op) const noexcept
+    {
+        return m_epoch(m_key_bounds(to_variant(key), op));
+    }
+
+    template<DB_type_primitive first_type>
+    uint64_t Write_Epoch_Pair_Prefix(const first_type& first, const operation& op) const noexcept
+    {
+        return m_epoch(m_pair_bounds(to_variant_p(first), op));
+    }
+
+    // K largest/smallest arithmetic values over the whole database, each value is one row
+    Result_type Top_K(size_t k, const rank& order) const noexcept;
+
+    template<DB_type key_type>
+    Result_type Top_K(const key_type& key, size_t k, const rank& order) const noexcept
+    {
+        const DB_variant probe = to_variant(key);
+        const auto bounds = m_key_bounds(probe, operation::KEY_EQUALS);
+        return m_cached<Result_type>(m_read_key(read_kind::TOP_K, &probe, static_cast<int>(order), k), m_epoch(bounds), [&] {return m_top_k(bounds, k, order);});
+    }
+
+    // streamed over the values, compressed keys are decoded block by block and nothing is copied
+    Aggregate_type Aggregate_Values() const noexcept;
+
+    template<DB_type key_type>
+    Aggregate_type Aggregate_Values(const key_type& key, const operation& op = operation::KEY_EQUALS) const noexcept
+    {
+        const DB_variant probe = to_variant(key);
+        const auto bounds = m_key_bounds(probe, op);
+        return m_cached<Aggregate_type>(m_read_key(read_kind::AGGREGATE, &probe, static_cast<int>(op)), m_epoch(bounds), [&] {return m_aggregate(bounds, true);},
+            [&](const Aggregate_type&) {m_touch_range(bounds);});
+    }
+
+    // bulk load of a CSV/TSV file (see CCsv_import) parsed by threads, 0 means one per core;
+    // returns the number of rows, throws std::runtime_error when the file cannot be read.
+    // The memory budget is enforced as the rows go in, only the parsed file is held on top of it.
+    size_t Import(const std::filesystem::path& file, char delimiter = ',', size_t threads = 0);
+
+    // HyperLogLog estimate of distinct values over the whole database, NaN when the disk tier
+    // could not be read; removed values may still be counted in it (see sketch_rebuild_ratio)
+    double Approx_Distinct() const noexcept;
+
+    // per key sketches of the keys selected as by Search_Key are merged
+    template<DB_type key_type>
+    double Approx_Distinct(const key_type& key, const operation& op = operation::KEY_EQUALS) const noexcept
+    {
+        const DB_variant probe = to_variant(key);
+        const auto bounds = m_key_bounds(probe, op);
+        return m_cached<double>(m_read_key(read_kind::DISTINCT, &probe, static_cast<int>(op)), m_epoch(bounds), [&] {
+            const auto merged = m_sketch(bounds);
+            return merged ? merged->Distinct() : std::numeric_limits<double>::quiet_NaN();
+            });
+    }
+
+    // KLL estimate of the q-quantile of arithmetic values, NaN when there are none
+    // or the disk tier could not be read
+    double Approx_Quantile(double q) const noexcept;
+
+    template<DB_type key_type>
+    double Approx_Quantile(const key_type& key, double q, const operation& op = operation::KEY_EQUALS) const noexcept
+    {
+        const DB_variant probe = to_variant(key);
+        const auto bounds = m_key_bounds(probe, op);
+        return m_cached<double>(m_read_key(read_kind::QUANTILE, &probe, static_cast<int>(op), 0, q), m_epoch(bounds), [&] {
+            const auto merged = m_sketch(bounds);
+            return merged ? merged->Quantile(q) : std::numeric_limits<double>::quiet_NaN();
+            });
+    }
+
+    // registers a query with the semantics of Search_Key, its result is then kept up to date by writes;
+    // no_query when the disk tier could not be read
+    template<DB_type key_type>
+    query_id Register_Query(const key_type& key, const operation& op) noexcept
+    {
+        return m_register(Query{ true, to_variant(key), op, nullptr, {}, {} });
+    }
+
+    // registers a query with the semantics of Find_Value
+    query_id Register_Query(functor_type func) noexcept;
+
+    bool Unregister_Query(query_id id) noexcept;
+
+    // current result of the query in O(result), invalid result for an unknown id
+    Result_type Query_Result(query_id id) const noexcept;
+
+    bool Subscribe(query_id id, subscriber_type subscriber) noexcept;
 
     // functor_type bude funktor/funkce/lambda, ktera splnuje koncept (vraci bool, zda vysledek vyhovuje nebo ne)
     Result_type Find_Value(functor_type func) const noexcept;
 
 private:
-    template<DB_type V>
-    void m_insert(std::vector<DB_variant>& vect, V value) noexcept
+    struct Row
+    {
+        std::vector<DB_variant> values;
+        CTimer_Wheel::tick_type expires = no_expiry;
+    };
+
+    struct Query
+    {
+        // key queries keep every matching key, value queries only keys with a matching value
+        bool by_key;
+        DB_variant key;
+        operation op;
+        functor_type func;
+        std::map<DB_variant, Row> rows;
+        std::vector<subscriber_type> subscribers;
+    };
+
+    std::map<query_id, Query> queries;
+    query_id next_query;
+
+    using range_type = std::pair<base_type::const_iterator, base_type::const_iterator>;
+
+    enum class read_kind
+    {
+        SEARCH,
+        PAIR_PREFIX,
+        TOP_K,
+        AGGREGATE,
+        DISTINCT,
+        QUANTILE
+    };
+
+    // the same read written differently maps to one cache entry, 1 and 1.0 or two close doubles do not;
+    // key is nullptr for reads over the whole database
+    static std::string m_read_key(read_kind read, const DB_variant* key, int op, size_t count = 0, double q = 0) noexcept;
+
+    static bool m_cacheable(const Result_type& result) noexcept
+    {
+        return result.isValid();
+    }
+
+    static bool m_cacheable(const Aggregate_type& result) noexcept
+    {
+        return result.valid;
+    }
+
+    static bool m_cacheable(double result) noexcept
+    {
+        // an unreadable disk tier is not remembered, no values are cheap to find out again
+        return !std::isnan(result);
+    }
+
+    // read answers a miss, its result is kept until a write stamps a newer epoch on its keys
+    // or one of the keys it visited expires; hit does to the eviction policy what read would have
+    template<typename T, typename F, typename H = void(*)(const T&)>
+    T m_cached(std::string&& key, uint64_t epoch, F&& read, H&& hit = [](const T&) {}) const noexcept
+    {
+        if (cache.Capacity() == 0)
+        {
+            return read();
+        }
+        if (const auto* cached = cache.Get(key, epoch, m_now()))
+        {
+            const T& result = std::get<T>(*cached);
+            hit(result);
+            return result;
+        }
+        visit_expires = no_expiry;
+        T result = read();
+        if (m_cacheable(result))
+        {
+            cache.Put(std::move(key), epoch, visit_expires, result);
+        }
+        return result;
+    }
+
+    // interval of keys, used for the map as well as for the disk tier
+    struct Key_bounds
+    {
+        DB_variant low;
+        bool low_inclusive;
+        // none is the end of the key space
+        std::optional<DB_variant> high;
+        bool high_inclusive;
+    };
+
+    // exactly one of entry (memory) and item (disk tier) is set, returns false to stop
+    using visitor_type = std::function<bool(const DB_variant& key, const Entry* entry, const CSorted_run::Item* item)>;
+
+    template<DB_type key_type>
+    static DB_variant to_variant(const key_type& key) noexcept
+    {
+        if constexpr (std::same_as<key_type, int>)
+        {
+            return DB_variant(key);
+        } else if constexpr (std::is_arithmetic_v<key_type>)
+        {
+            return DB_variant(static_cast<double>(key));
+        } else if constexpr (std::is_convertible_v<key_type, std::string>)
+        {
+            return DB_variant(std::string(key));
+        } else
+        {
+            return DB_variant(static_cast<const Pair&>(key));
+        }
+    }
+
+    template<DB_type_primitive first_type>
+    static DB_variant_p to_variant_p(const first_type& first) noexcept
+    {
+        if constexpr (std::same_as<first_type, int>)
+        {
+            return DB_variant_p(first);
+        } else if constexpr (std::is_arithmetic_v<first_type>)
+        {
+            return DB_variant_p(static_cast<double>(first));
+        } else
+        {
+            return DB_variant_p(std::string(first));
+        }
+    }
+
+    static Key_bounds m_all_bounds() noexcept;
+    static std::vector<Key_bounds> m_pair_bounds(const DB_variant_p& first, const operation& op) noexcept;
+    static std::vector<Key_bounds> m_key_bounds(const DB_variant& key, const operation& op) noexcept;
+    range_type m_range(const Key_bounds& bounds) const noexcept;
+    // alive keys within bounds in key order, memory shadows the disk tier;
+    // false when a disk run could not be read, the visit stopped there
+    bool m_visit(const Key_bounds& bounds, const visitor_type& visit) const noexcept;
+    Result_type m_search(const std::vector<Key_bounds>& bounds, size_t limit) const noexcept;
+    Result_type m_top_k(const std::vector<Key_bounds>& bounds, size_t k, const rank& order) const noexcept;
+    // keys of the result still in memory are marked as used, spilled ones are not read back for it
+    void m_touch_rows(const Result_type& result) const noexcept;
+    void m_touch_range(const std::vector<Key_bounds>& bounds) const noexcept;
+    // touch marks the keys as used for the eviction policy, like a search does
+    Aggregate_type m_aggregate(const std::vector<Key_bounds>& bounds, bool touch) const noexcept;
+    std::optional<CValue_sketch> m_sketch(const std::vector<Key_bounds>& bounds) const noexcept;
+    uint64_t m_epoch(const std::vector<Key_bounds>& bounds) const noexcept;
+    void m_bump(const DB_variant& key) noexcept;
+    // nullptr when the disk tier could not be read
+    const CValue_sketch* m_global_sketch() const noexcept;
+    // adds entry.values from first on, they were just appended
+    void m_sketch_add(Entry& entry, size_t first) noexcept;
+
+    inline void m_sketch_remove(uint64_t values) noexcept
+    {
+        sketch_removed += values;
+    }
+
+    inline static size_t m_value_count(const Entry& entry) noexcept
+    {
+        return entry.compressed ? entry.compressed->size() : entry.values.size();
+    }
+
+    inline void m_touch(const Entry& entry) const noexcept
+    {
+        if (policy)
+        {
+            policy->Touch(entry.handle);
+        }
+    }
+
+    inline CTimer_Wheel::tick_type m_now() const noexcept
     {
-        vect.push_back(value);
+        return static_cast<CTimer_Wheel::tick_type>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch).count());
     }
 
-    template<DB_type V, DB_type... VALS>
-    void m_insert(std::vector<DB_variant>& vect, V value, VALS... values) noexcept
+    inline bool m_alive(const Entry& entry, CTimer_Wheel::tick_type now) const noexcept
+    {
+        return entry.expires > now;
+    }
+
+    inline Record m_record(const DB_variant& key, const Entry& entry) const noexcept
+    {
+        return entry.compressed ? Record(key, entry.compressed->Decode()) : Record(key, entry.values);
+    }
+
+    template<typename F>
+    void m_for_each_value(const Entry& entry, F&& func) const noexcept
+    {
+        if (entry.compressed)
+        {
+            entry.compressed->For_Each(func);
+            return;
+        }
+        for (const auto& value : entry.values)
+        {
+            func(value);
+        }
+    }
+
+    template<typename F>
+    void m_for_each_value(const Entry* entry, const CSorted_run::Item* item, F&& func) const noexcept
+    {
+        if (entry != nullptr)
+        {
+            m_for_each_value(*entry, func);
+            return;
+        }
+        for (const auto& value : item->values)
+        {
+            func(value);
+        }
+    }
+
+    void m_decompress(base_type::iterator it) noexcept;
+    query_id m_register(Query&& query) noexcept;
+    bool m_query_matches(const Query& query, const DB_variant& key) const noexcept;
+    void m_query_add(base_type::iterator it) noexcept;
+    void m_query_push(base_type::iterator it, const DB_variant& value) noexcept;
+    void m_query_remove(base_type::iterator it, const DB_variant& value) noexcept;
+    void m_query_erase(const DB_variant& key, bool keep_key) noexcept;
+    void m_query_expire(base_type::iterator it) noexcept;
+    Result_type m_expire(const DB_variant& key, std::chrono::milliseconds ttl) noexcept;
+    size_t m_entry_size(const DB_variant& key, const Entry& entry) const noexcept;
+    // key in memory, read back from the disk tier if it was spilled; end if absent
+    inline base_type::iterator m_find(const DB_variant& key) noexcept
+    {
+        return m_find(base.lower_bound(key), key);
+    }
+    // position is base.lower_bound(key), so sorted bulk writes need no lookups
+    base_type::iterator m_find(base_type::iterator position, const DB_variant& key) noexcept;
+    inline base_type::iterator m_entry(DB_variant&& key) noexcept
     {
-        vect.push_back(value);
-        m_insert(vect, values...);
+        auto position = base.lower_bound(key);
+        return m_entry(position, std::move(key));
     }
+    base_type::iterator m_entry(base_type::iterator position, DB_variant&& key) noexcept;
+    void m_push(base_type::iterator it, DB_variant&& value) noexcept;
+    void m_append(base_type::iterator it, std::vector<DB_variant>&& values) noexcept;
+    void m_remove(base_type::iterator it, const DB_variant& value) noexcept;
+    void m_clear(base_type::iterator it) noexcept;
+    // spilled keys still exist in the disk tier, so registered queries keep them
+    void m_erase(base_type::iterator it, bool spilled = false) noexcept;
+    void m_spill(base_type::iterator keep) noexcept;
+    void m_enforce_budget(base_type::iterator keep) noexcept;
 
-    template<DB_type V>
-    void m_delete(std::vector<DB_variant>& vect, V value) noexcept
+    template<DB_type... VALS>
+    void m_insert(base_type::iterator it, VALS... values) noexcept
     {
-        DB_variant val(value);
-        vect.erase(std::remove(vect.begin(), vect.end(), val));
+        (m_push(it, to_variant(values)), ...);
     }
 
-    template<DB_type V, DB_type... VALS>
-    void m_delete(std::vector<DB_variant>& vect, V value, VALS... values) noexcept
+    template<DB_type... VALS>
+    void m_delete(base_type::iterator it, VALS... values) noexcept
     {
-        DB_variant val(value);
-        vect.erase(std::remove(vect.begin(), vect.end(), val));
-        Delete(vect, values...);
+        (m_remove(it, to_variant(values)), ...);
     }
 };
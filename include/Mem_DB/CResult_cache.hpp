@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <list>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+
+#include <Mem_DB/Result_type.hpp>
+
+// LRU cache of read results keyed by the normalized read. Every result is stored with the write
+// epoch of the keys it was read from and the tick its first key expires at, it is stale once
+// the epoch moved on or the tick passed.
+class CResult_cache
+{
+public:
+    using value_type = std::variant<Result_type, Aggregate_type, double>;
+
+    // capacity in bytes, 0 turns the cache off
+    explicit CResult_cache(size_t capacity = 0) noexcept :capacity(capacity), used(0), hits(0), misses(0), entries({}), index({}) {};
+
+    // nullptr on a miss, the pointer is valid until the next Put
+    const value_type* Get(const std::string& read, uint64_t epoch, uint64_t now) noexcept;
+    void Put(std::string read, uint64_t epoch, uint64_t valid_until, value_type result) noexcept;
+
+    void Set_Capacity(size_t bytes) noexcept;
+    void Clear() noexcept;
+
+    inline size_t Capacity() const noexcept
+    {
+        return capacity;
+    }
+
+    inline size_t Memory_Usage() const noexcept
+    {
+        return used;
+    }
+
+    inline size_t Hits() const noexcept
+    {
+        return hits;
+    }
+
+    inline size_t Misses() const noexcept
+    {
+        return misses;
+    }
+
+private:
+    struct Cached
+    {
+        std::string read;
+        uint64_t epoch;
+        uint64_t valid_until;
+        value_type result;
+        // counted once, results are not cheap to measure
+        size_t size;
+    };
+
+    void m_erase(std::list<Cached>::iterator it) noexcept;
+    void m_shrink(size_t limit) noexcept;
+
+    size_t capacity;
+    size_t used;
+    size_t hits;
+    size_t misses;
+    // most recently used first
+    std::list<Cached> entries;
+    std::unordered_map<std::string_view, std::list<Cached>::iterator> index;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include <Mem_DB/p_types.hpp>
+
+// HyperLogLog distinct counter, 2^precision one byte registers,
+// standard error is about 1.04 / sqrt(2^precision)
+class CHyper_log_log
+{
+public:
+    explicit CHyper_log_log(unsigned precision = 12) noexcept;
+
+    void Add(uint64_t hash) noexcept;
+    // only sketches of the same precision can be merged, returns false otherwise
+    bool Merge(const CHyper_log_log& other) noexcept;
+    double Estimate() const noexcept;
+
+    inline size_t Memory_Usage() const noexcept
+    {
+        return registers.capacity();
+    }
+
+private:
+    unsigned precision;
+    std::vector<uint8_t> registers;
+};
+
+// KLL quantile sketch, a stack of compactors where level h items weigh 2^h,
+// rank error is about 1.65 / k with high probability
+class CKLL_sketch
+{
+public:
+    explicit CKLL_sketch(size_t k = 200) noexcept;
+
+    void Add(double value) noexcept;
+    void Merge(const CKLL_sketch& other) noexcept;
+    // q in [0, 1], NaN when nothing was added
+    double Quantile(double q) const noexcept;
+
+    inline uint64_t size() const noexcept
+    {
+        return count;
+    }
+
+    size_t Memory_Usage() const noexcept;
+
+private:
+    size_t m_capacity(size_t level) const noexcept;
+    void m_grow() noexcept;
+    void m_compress() noexcept;
+
+    size_t k;
+    uint64_t count;
+    size_t retained;
+    // sum of the level capacities, they only change when a level is added
+    size_t capacity;
+    // random offset of every compaction, xorshift so that sketches stay small and deterministic
+    uint64_t coin;
+    std::vector<std::vector<double>> levels;
+};
+
+// distinct count of all values and quantiles of the numeric ones
+class CValue_sketch
+{
+public:
+    explicit CValue_sketch(unsigned precision = 12, size_t k = 200) noexcept :distinct(precision), quantiles(k) {};
+
+    void Add(const DB_variant& value) noexcept;
+    bool Merge(const CValue_sketch& other) noexcept;
+
+    inline double Distinct() const noexcept
+    {
+        return distinct.Estimate();
+    }
+
+    inline double Quantile(double q) const noexcept
+    {
+        return quantiles.Quantile(q);
+    }
+
+    inline size_t Memory_Usage() const noexcept
+    {
+        return sizeof(CValue_sketch) + distinct.Memory_Usage() + quantiles.Memory_Usage();
+    }
+
+private:
+    CHyper_log_log distinct;
+    CKLL_sketch quantiles;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+
+#include <Mem_DB/p_types.hpp>
+
+// Bloom filter over key hashes, double hashing of one 64 bit hash
+class CBloom_filter
+{
+public:
+    explicit CBloom_filter(size_t keys, size_t bits_per_key = 10) noexcept;
+
+    void Add(uint64_t hash) noexcept;
+    bool May_Contain(uint64_t hash) const noexcept;
+
+    inline size_t Memory_Usage() const noexcept
+    {
+        return bits.capacity() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint64_t> bits;
+    size_t hashes;
+};
+
+// Immutable file of records sorted by key with a Bloom filter and a sparse index kept in memory.
+// The file is removed when the run is destroyed after Obsolete was called.
+class CSorted_run : public std::enable_shared_from_this<CSorted_run>
+{
+public:
+    struct Item
+    {
+        DB_variant key;
+        // tick of CMemory_Database the key is absent from, max when it does not expire
+        uint64_t expires;
+        std::vector<DB_variant> values;
+    };
+
+    // expires of an item that only shadows older versions of its key
+    static constexpr uint64_t tombstone = 0;
+
+    // every index_step-th record has an entry in the sparse index
+    static constexpr size_t index_step = 16;
+
+    // items are appended in strictly increasing key order
+    class Writer
+    {
+    public:
+        Writer(std::string path, size_t expected_items);
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer();
+
+        void Add(const Item& item);
+        std::shared_ptr<CSorted_run> Finish();
+
+    private:
+        void m_flush();
+
+        std::shared_ptr<CSorted_run> run;
+        std::string buffer;
+        uint64_t offset;
+    };
+
+    // sequential reader of records starting at a sparse index position
+    class Cursor
+    {
+    public:
+        Cursor(std::shared_ptr<const CSorted_run> run, uint64_t offset) noexcept
+            :run(std::move(run)), offset(offset), buffer({}), position(0) {};
+
+        // false at the end of the run, throws when the file cannot be read
+        bool Next(Item& item);
+
+    private:
+        bool m_fill(size_t bytes);
+
+        std::shared_ptr<const CSorted_run> run;
+        uint64_t offset;
+        std::string buffer;
+        size_t position;
+    };
+
+    CSorted_run(const CSorted_run&) = delete;
+    CSorted_run& operator=(const CSorted_run&) = delete;
+    ~CSorted_run();
+
+    // Bloom filter check first, then at most index_step records are read
+    std::optional<Item> Get(const DB_variant& key) const;
+
+    // cursor at the last indexed record not greater than key, records before key have to be skipped
+    Cursor Seek(const DB_variant& key) const;
+
+    inline size_t size() const noexcept
+    {
+        return count;
+    }
+
+    inline uint64_t Bytes() const noexcept
+    {
+        return file_size;
+    }
+
+    inline void Obsolete() noexcept
+    {
+        obsolete = true;
+    }
+
+private:
+    CSorted_run(std::string path, size_t expected_items);
+
+    std::string path;
+    int fd;
+    uint64_t file_size;
+    size_t count;
+    bool obsolete;
+    CBloom_filter bloom;
+    std::vector<std::pair<DB_variant, uint64_t>> index;
+};
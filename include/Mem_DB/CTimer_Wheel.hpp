@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <vector>
+#include <functional>
+
+#include <Mem_DB/p_types.hpp>
+
+// Hierarchical timer wheel of keys. Scheduling is O(1) and advancing the time costs
+// O(elapsed ticks + fired timers), timers are only moved to a finer level when its slot comes up.
+class CTimer_Wheel
+{
+public:
+    using tick_type = uint64_t;
+
+    struct Timer
+    {
+        tick_type deadline;
+        DB_variant key;
+    };
+
+    using expired_type = std::function<void(Timer&& timer)>;
+
+    CTimer_Wheel() noexcept :current(0), count(0), levels({}), overflow({}), due({}) {};
+
+    void Schedule(tick_type deadline, const DB_variant& key);
+
+    // moves the time to now and hands every timer with deadline <= now to expired
+    void Advance(tick_type now, const expired_type& expired);
+
+    inline tick_type Now() const noexcept
+    {
+        return current;
+    }
+
+    inline size_t size() const noexcept
+    {
+        return count;
+    }
+
+private:
+    static constexpr size_t slot_bits = 6;
+    static constexpr size_t slots = size_t(1) << slot_bits;
+    static constexpr size_t level_count = 4;
+
+    using slot_type = std::vector<Timer>;
+
+    void m_place(Timer&& timer);
+    void m_cascade(size_t level);
+
+    tick_type current;
+    size_t count;
+    std::array<std::array<slot_type, slots>, level_count> levels;
+    // deadlines further than the top level covers, placed again whenever the top level wraps
+    slot_type overflow;
+    // deadlines which were already due when scheduled
+    slot_type due;
+};
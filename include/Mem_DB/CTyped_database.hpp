@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstddef>
+#include <cmath>
+
+#include <map>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+#include <span>
+#include <ostream>
+
+#include <Mem_DB/p_types.hpp>
+#include <Mem_DB/Result_type.hpp>
+#include <Mem_DB/CMemory_Database.hpp>
+
+// alternatives of DB_variant, the types a typed database can store as they are
+template<typename T>
+concept DB_stored_type = DB_type<T> && (std::same_as<T, int> || std::same_as<T, double> || std::same_as<T, std::string> || std::same_as<T, Pair>);
+
+template<DB_stored_type Key, DB_stored_type Value>
+class CTyped_database;
+
+// Result of a typed database, its rows view the keys and values stored in the database,
+// only values picked out by Find_Value are held by the result itself.
+// A view is valid until the next write to the database, so it can be moved but not copied.
+template<DB_stored_type Key, DB_stored_type Value>
+class CTyped_result
+{
+public:
+    struct Row
+    {
+        const Key* key;
+        std::span<const Value> values;
+    };
+
+    CTyped_result() noexcept :rows({}), owned({}) {};
+    CTyped_result(const CTyped_result&) = delete;
+    CTyped_result& operator=(const CTyped_result&) = delete;
+    CTyped_result(CTyped_result&&) noexcept = default;
+    CTyped_result& operator=(CTyped_result&&) noexcept = default;
+
+    inline size_t getLines() const noexcept
+    {
+        return rows.size();
+    }
+
+    inline bool empty() const noexcept
+    {
+        return rows.empty();
+    }
+
+    inline const std::vector<Row>& getRows() const noexcept
+    {
+        return rows;
+    }
+
+    // same text as Result_type
+    friend std::ostream& operator<<(std::ostream& s, const CTyped_result& r) noexcept
+    {
+        s << "OK" << std::endl;
+        s << r.rows.size() << " rows." << std::endl;
+        if (r.rows.empty())
+        {
+            s << "Empty." << std::endl;
+            return s;
+        }
+        for (const auto& row : r.rows)
+        {
+            m_print(s, *row.key);
+            s << " - ";
+            for (size_t i = 0; i < row.values.size(); i++)
+            {
+                if (i != 0)
+                {
+                    s << ", ";
+                }
+                m_print(s, row.values[i]);
+            }
+            s << std::endl;
+        }
+        return s;
+    }
+
+private:
+    friend class CTyped_database<Key, Value>;
+
+    template<typename T>
+    static void m_print(std::ostream& s, const T& value) noexcept
+    {
+        if constexpr (std::same_as<T, std::string>)
+        {
+            s << "\"" << value << "\"";
+        } else
+        {
+            s << value;
+        }
+    }
+
+    void m_add(const Key& key, std::span<const Value> values) noexcept
+    {
+        rows.push_back({ &key, values });
+    }
+
+    void m_add(const Key& key, std::vector<Value>&& values) noexcept
+    {
+        // a moved vector keeps its buffer, so the spans survive owned growing
+        owned.push_back(std::move(values));
+        rows.push_back({ &key, owned.back() });
+    }
+
+    std::vector<Row> rows;
+    std::vector<std::vector<Value>> owned;
+};
+
+// Database with the key and value type fixed at compile time. Keys and values are stored
+// as plain Key and Value, so writes and searches need no variant and no std::visit.
+// Comparisons are the same as of CMemory_Database holding keys of one type (string and Pair keys
+// compare as key <=> stored key), results are CTyped_result views printing as Result_type does. There is no time to live, memory budget,
+// disk tier or continuous query, CMemory_Database stays the database for mixed and changing schemas.
+template<DB_stored_type Key, DB_stored_type Value>
+class CTyped_database
+{
+public:
+    using operation = CMemory_Database::operation;
+    using functor_type = std::function<bool(const Key& key, const Value& value)>;
+    using result_type = CTyped_result<Key, Value>;
+    static constexpr size_t no_limit = CMemory_Database::no_limit;
+
+    CTyped_database() noexcept :base(base_type()) {};
+
+    template<std::convertible_to<Key> key_type, std::convertible_to<Value>... Vals>
+    result_type Insert(key_type key, Vals... values) noexcept
+    {
+        auto it = base.try_emplace(static_cast<Key>(key)).first;
+        (it->second.push_back(static_cast<Value>(values)), ...);
+        result_type result;
+        result.m_add(it->first, it->second);
+        return result;
+    }
+
+    template<std::convertible_to<Key> key_type>
+    result_type Delete(key_type key) noexcept
+    {
+        auto it = base.try_emplace(static_cast<Key>(key)).first;
+        it->second = std::vector<Value>();
+        result_type result;
+        result.m_add(it->first, it->second);
+        return result;
+    }
+
+    template<std::convertible_to<Key> key_type, std::convertible_to<Value>... Vals>
+    result_type Delete(key_type key, Vals... values) noexcept
+    {
+        auto it = base.try_emplace(static_cast<Key>(key)).first;
+        (std::erase(it->second, static_cast<Value>(values)), ...);
+        result_type result;
+        result.m_add(it->first, it->second);
+        return result;
+    }
+
+    result_type Search_Key(const Key& key, const operation& op, size_t limit = no_limit) const noexcept
+    {
+        result_type result;
+        auto [first, last] = m_range(key, op);
+        for (auto it = first; it != last && result.getLines() < limit; ++it)
+        {
+            result.m_add(it->first, it->second);
+        }
+        return result;
+    }
+
+    result_type Find_Value(functor_type func) const noexcept
+    {
+        result_type result;
+        std::vector<Value> matched;
+        for (const auto& [key, values] : base)
+        {
+            for (const auto& value : values)
+            {
+                if (func(key, value))
+                {
+                    matched.push_back(value);
+                }
+            }
+            if (matched.empty())
+            {
+                continue;
+            }
+            if (matched.size() == values.size())
+            {
+                // every value matched, the stored ones are viewed instead
+                result.m_add(key, values);
+                matched.clear();
+            } else
+            {
+                result.m_add(key, std::move(matched));
+                matched = std::vector<Value>();
+            }
+        }
+        return result;
+    }
+
+    inline size_t size() const noexcept
+    {
+        return base.size();
+    }
+
+private:
+    using base_type = std::map<Key, std::vector<Value>>;
+    using range_type = std::pair<typename base_type::const_iterator, typename base_type::const_iterator>;
+
+    range_type m_range(const Key& key, const operation& op) const noexcept
+    {
+        using enum operation;
+        if constexpr (std::same_as<Key, double>)
+        {
+            if (std::isnan(key))
+            {
+                return { base.end(), base.end() };
+            }
+        }
+        // same directions as CMemory_Database::m_key_bounds
+        constexpr bool reversed = !std::is_arithmetic_v<Key>;
+        switch (op)
+        {
+        case KEY_EQUALS:  return { base.lower_bound(key), base.upper_bound(key) };
+        case KEY_GREATER: return reversed ? range_type(base.begin(), base.lower_bound(key)) : range_type(base.upper_bound(key), base.end());
+        case KEY_LESS:    return reversed ? range_type(base.upper_bound(key), base.end()) : range_type(base.begin(), base.lower_bound(key));
+        default:          return { base.end(), base.end() };
+        }
+    }
+
+    base_type base;
+};
@@ -1,9 +1,13 @@
+#pragma once
+
+#include <limits>
 
 #include <Mem_DB/p_types.hpp>
 
 class Record {
 public:
     Record(const DB_variant& key, const std::vector<DB_variant>& vals) noexcept :key(key), values(vals) {};
+    Record(const DB_variant& key, std::vector<DB_variant>&& vals) noexcept :key(key), values(std::move(vals)) {};
     Record(const DB_variant& key, const DB_variant& value) noexcept :key(key), values({})
     {
         values.push_back(value);
@@ -23,17 +27,27 @@ public:
         return values;
     }
 
+    // bytes of the record including its key and values
+    size_t Memory_Usage() const noexcept
+    {
+        size_t bytes = sizeof(Record) + heap_size(key) + values.capacity() * sizeof(DB_variant);
+        for (const auto& value : values)
+        {
+            bytes += heap_size(value);
+        }
+        return bytes;
+    }
+
     friend std::ostream& operator<<(std::ostream& s, const Record& r) noexcept
     {
         s << r.key;
         s << " - ";
-        size_t i;
-        for (i = 0; i < (r.values.size() - 1); i++)
-        {
-            s << r.values[i] << ", ";
-        }
-        if (r.values.size() != 0)
+        for (size_t i = 0; i < r.values.size(); i++)
         {
+            if (i != 0)
+            {
+                s << ", ";
+            }
             s << r.values[i];
         }
         return s;
@@ -55,6 +69,11 @@ public:
         records.push_back(rec);
         lines++;
     }
+    void add(Record&& rec) noexcept
+    {
+        records.push_back(std::move(rec));
+        lines++;
+    }
     void add(const DB_variant& key, const DB_variant& value) noexcept
     {
         auto ri = std::find_if(records.begin(), records.end(), [&key](const Record& i) {return key == i.key;});
@@ -88,6 +107,26 @@ public:
         return records.size() == 0;
     }
 
+    inline bool isValid() const noexcept
+    {
+        return valid;
+    }
+
+    inline const std::vector<Record>& getRecords() const noexcept
+    {
+        return records;
+    }
+
+    size_t Memory_Usage() const noexcept
+    {
+        size_t bytes = sizeof(Result_type) + (records.capacity() - records.size()) * sizeof(Record);
+        for (const auto& record : records)
+        {
+            bytes += record.Memory_Usage();
+        }
+        return bytes;
+    }
+
     std::vector<DB_variant> getValues() const noexcept
     {
         std::vector<DB_variant> ret;
@@ -121,4 +160,17 @@ private:
     std::vector<Record> records;
 };
 
-
+// of the values of the selected keys, only int and double values are arithmetic
+struct Aggregate_type
+{
+    // false when the disk tier could not be read
+    bool valid = true;
+    size_t rows = 0;
+    // rows with at least one arithmetic value
+    size_t arithmetic_rows = 0;
+    size_t values = 0;
+    size_t arithmetic_values = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+};
@@ -18,6 +18,11 @@ using DB_variant_p = std::variant<int, double, std::string>;
 
 std::ostream& operator<<(std::ostream& s, const DB_variant_p& var) noexcept;
 
+// bytes allocated on the heap by the value, not counting sizeof the variant itself
+size_t heap_size(const DB_variant_p& var) noexcept;
+
+size_t hash_value(const DB_variant_p& var) noexcept;
+
 
 class Pair {
 public:
@@ -55,6 +60,16 @@ public:
         return second;
     }
 
+    size_t heapSize() const noexcept
+    {
+        return heap_size(first) + heap_size(second);
+    }
+
+    size_t hashValue() const noexcept
+    {
+        return hash_value(first) * 31 + hash_value(second);
+    }
+
     friend std::ostream& operator<<(std::ostream& s, const Pair& p) noexcept
     {
         s << "[";
@@ -79,6 +94,12 @@ using DB_variant = std::variant<int, double, std::string, Pair>;
 
 std::ostream& operator<<(std::ostream& s, const DB_variant& var) noexcept;
 
+size_t heap_size(const DB_variant& var) noexcept;
+
+size_t heap_size(const std::string& str) noexcept;
+
+size_t hash_value(const DB_variant& var) noexcept;
+
 
 using functor_type = std::function<bool(const DB_variant& key, const DB_variant& value)>;
 
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+#include <string>
+#include <stdexcept>
+
+// spreads the bits of a hash, std::hash of int is the identity
+uint64_t mix_hash(uint64_t x) noexcept;
+
+// what failed with the errno message
+std::runtime_error sys_error(const std::string& what);
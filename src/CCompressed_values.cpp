@@ -0,0 +1,216 @@
+#include <Mem_DB/CCompressed_values.hpp>
+
+#include <bit>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+uint64_t zigzag(int64_t value) noexcept
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) noexcept
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// appends the bit width of the block and the values packed with that width
+void pack(const uint64_t* values, size_t n, std::vector<uint64_t>& out)
+{
+    uint64_t all = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        all |= values[i];
+    }
+    const size_t width = static_cast<size_t>(std::bit_width(all));
+    out.push_back(width);
+    if (width == 0)
+    {
+        return;
+    }
+    const size_t start = out.size();
+    out.resize(start + (n * width + 63) / 64, 0);
+    size_t bit = 0;
+    for (size_t i = 0; i < n; i++, bit += width)
+    {
+        const size_t word = start + bit / 64;
+        const size_t offset = bit % 64;
+        out[word] |= values[i] << offset;
+        if (offset + width > 64)
+        {
+            out[word + 1] |= values[i] >> (64 - offset);
+        }
+    }
+}
+
+// returns the number of words the block took
+size_t unpack(const uint64_t* in, size_t n, uint64_t* values) noexcept
+{
+    const size_t width = static_cast<size_t>(in[0]);
+    if (width == 0)
+    {
+        std::fill(values, values + n, 0);
+        return 1;
+    }
+    const uint64_t* words = in + 1;
+    const uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+    size_t bit = 0;
+    for (size_t i = 0; i < n; i++, bit += width)
+    {
+        const size_t word = bit / 64;
+        const size_t offset = bit % 64;
+        uint64_t value = words[word] >> offset;
+        if (offset + width > 64)
+        {
+            value |= words[word + 1] << (64 - offset);
+        }
+        values[i] = value & mask;
+    }
+    return 1 + (n * width + 63) / 64;
+}
+
+}
+
+CCompressed_values::CCompressed_values(const std::vector<DB_variant>& values)
+    :count(values.size()), bytes(0), runs({}), ints({}), codes({}), doubles({}), dictionary({}), others({})
+{
+    std::unordered_map<std::string, uint64_t> codes_of;
+    std::vector<uint64_t> block;
+    block.reserve(block_size);
+    size_t i = 0;
+    while (i < values.size())
+    {
+        const kind type = static_cast<kind>(values[i].index());
+        size_t end = i;
+        while (end < values.size() && static_cast<kind>(values[end].index()) == type)
+        {
+            end++;
+        }
+        runs.push_back({ type, end - i });
+        int64_t previous = 0;
+        for (size_t first = i; first < end; first += block_size)
+        {
+            const size_t last = std::min(end, first + block_size);
+            block.clear();
+            for (size_t j = first; j < last; j++)
+            {
+                switch (type)
+                {
+                case kind::INT:
+                {
+                    const int64_t value = std::get<int>(values[j]);
+                    block.push_back(zigzag(value - previous));
+                    previous = value;
+                    break;
+                }
+                case kind::STRING:
+                {
+                    const auto& str = std::get<std::string>(values[j]);
+                    auto [it, added] = codes_of.try_emplace(str, dictionary.size());
+                    if (added)
+                    {
+                        dictionary.push_back(str);
+                    }
+                    block.push_back(it->second);
+                    break;
+                }
+                case kind::DOUBLE:
+                    doubles.push_back(std::get<double>(values[j]));
+                    break;
+                default:
+                    others.push_back(values[j]);
+                    break;
+                }
+            }
+            if (type == kind::INT)
+            {
+                pack(block.data(), block.size(), ints);
+            } else if (type == kind::STRING)
+            {
+                pack(block.data(), block.size(), codes);
+            }
+        }
+        i = end;
+    }
+    runs.shrink_to_fit();
+    ints.shrink_to_fit();
+    codes.shrink_to_fit();
+    doubles.shrink_to_fit();
+    dictionary.shrink_to_fit();
+    others.shrink_to_fit();
+
+    bytes = sizeof(*this)
+        + runs.capacity() * sizeof(Run)
+        + ints.capacity() * sizeof(uint64_t)
+        + codes.capacity() * sizeof(uint64_t)
+        + doubles.capacity() * sizeof(double)
+        + dictionary.capacity() * sizeof(std::string)
+        + others.capacity() * sizeof(DB_variant);
+    for (const auto& str : dictionary)
+    {
+        bytes += heap_size(str);
+    }
+    for (const auto& other : others)
+    {
+        bytes += heap_size(other);
+    }
+}
+
+size_t CCompressed_values::Decoder::Next(DB_variant* out)
+{
+    while (run < data.runs.size() && done == data.runs[run].length)
+    {
+        run++;
+        done = 0;
+        previous = 0;
+    }
+    if (run == data.runs.size())
+    {
+        return 0;
+    }
+    const auto& current = data.runs[run];
+    const size_t n = std::min(block_size, current.length - done);
+    uint64_t block[block_size];
+    switch (current.type)
+    {
+    case kind::INT:
+        int_pos += unpack(data.ints.data() + int_pos, n, block);
+        for (size_t i = 0; i < n; i++)
+        {
+            previous += unzigzag(block[i]);
+            out[i] = static_cast<int>(previous);
+        }
+        break;
+    case kind::STRING:
+        code_pos += unpack(data.codes.data() + code_pos, n, block);
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = data.dictionary[block[i]];
+        }
+        break;
+    case kind::DOUBLE:
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = data.doubles[double_pos++];
+        }
+        break;
+    default:
+        for (size_t i = 0; i < n; i++)
+        {
+            out[i] = data.others[other_pos++];
+        }
+        break;
+    }
+    done += n;
+    return n;
+}
+
+std::vector<DB_variant> CCompressed_values::Decode() const
+{
+    std::vector<DB_variant> values;
+    values.reserve(count);
+    For_Each([&](const DB_variant& value) {values.push_back(value);});
+    return values;
+}
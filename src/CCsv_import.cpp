@@ -0,0 +1,229 @@
+#include <Mem_DB/CCsv_import.hpp>
+#include <Mem_DB/sys_util.hpp>
+
+#include <cmath>
+#include <cstring>
+
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CCsv_import::CCsv_import(const std::filesystem::path& file, char delimiter)
+    :data(nullptr), length(0), delimiter(delimiter)
+{
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        throw sys_error("open " + file.string());
+    }
+    struct stat st {};
+    if (fstat(fd, &st) == -1)
+    {
+        close(fd);
+        throw sys_error("fstat " + file.string());
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0)
+    {
+        close(fd);
+        return;
+    }
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        length = 0;
+        throw sys_error("mmap " + file.string());
+    }
+    madvise(mapped, length, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapped);
+}
+
+CCsv_import::~CCsv_import()
+{
+    if (data != nullptr)
+    {
+        munmap(const_cast<char*>(data), length);
+    }
+}
+
+std::vector<std::vector<CCsv_import::Row>> CCsv_import::Parse(size_t threads) const
+{
+    threads = std::max<size_t>(threads, 1);
+    // chunks end right after a line break, so no line is split between threads
+    std::vector<size_t> bounds{ 0 };
+    for (size_t i = 1; i < threads; i++)
+    {
+        size_t pos = std::max(length / threads * i, bounds.back());
+        const void* newline = pos < length ? std::memchr(data + pos, '\n', length - pos) : nullptr;
+        pos = newline == nullptr ? length : static_cast<size_t>(static_cast<const char*>(newline) - data) + 1;
+        bounds.push_back(pos);
+    }
+    bounds.push_back(length);
+
+    std::vector<std::vector<Row>> batches(threads);
+    // an exception must not leave a thread (std::terminate), it is rethrown once all are joined
+    std::vector<std::exception_ptr> errors(threads);
+    auto parse = [&](size_t i) {
+        try {
+            m_parse_chunk(bounds[i], bounds[i + 1], batches[i]);
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t i = 1; i < threads; i++)
+    {
+        try {
+            workers.emplace_back(parse, i);
+        }
+        catch (std::system_error&)
+        {
+            // no thread left, the chunk is parsed here
+            parse(i);
+        }
+    }
+    parse(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    for (const auto& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    return batches;
+}
+
+void CCsv_import::m_parse_chunk(size_t begin, size_t end, std::vector<Row>& rows) const
+{
+    std::vector<DB_variant> fields;
+    while (begin < end)
+    {
+        const void* newline = std::memchr(data + begin, '\n', end - begin);
+        const size_t line_end = newline == nullptr ? end : static_cast<size_t>(static_cast<const char*>(newline) - data);
+        std::string_view line(data + begin, line_end - begin);
+        begin = line_end + 1;
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        if (line.empty())
+        {
+            continue;
+        }
+        Parse_Line(line, delimiter, fields);
+        Row row{ std::move(fields.front()), {} };
+        row.values.reserve(fields.size() - 1);
+        std::move(fields.begin() + 1, fields.end(), std::back_inserter(row.values));
+        rows.push_back(std::move(row));
+    }
+    auto by_key = [](const Row& l, const Row& r) {return l.key < r.key;};
+    if (std::is_sorted(rows.begin(), rows.end(), by_key))
+    {
+        return;
+    }
+    // indices are sorted instead of the rows, so every row is moved only once;
+    // stable, so values of a key repeated on several lines keep the file order
+    std::vector<size_t> order(rows.size());
+    if (std::all_of(rows.begin(), rows.end(), [](const Row& row) {return std::holds_alternative<int>(row.key);}))
+    {
+        // common case of int keys, plain pairs sort without going through the variant
+        std::vector<std::pair<int, size_t>> keys;
+        keys.reserve(rows.size());
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            keys.emplace_back(std::get<int>(rows[i].key), i);
+        }
+        std::sort(keys.begin(), keys.end());
+        std::transform(keys.begin(), keys.end(), order.begin(), [](const auto& key) {return key.second;});
+    } else
+    {
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {return by_key(rows[l], rows[r]);});
+    }
+    std::vector<Row> sorted;
+    sorted.reserve(rows.size());
+    for (const auto i : order)
+    {
+        sorted.push_back(std::move(rows[i]));
+    }
+    rows.swap(sorted);
+}
+
+void CCsv_import::Parse_Line(std::string_view line, char delimiter, std::vector<DB_variant>& fields)
+{
+    fields.clear();
+    size_t pos = 0;
+    while (true)
+    {
+        if (pos < line.size() && line[pos] == '"')
+        {
+            // "" inside quotes is one quote
+            std::string str;
+            pos++;
+            while (pos < line.size())
+            {
+                if (line[pos] == '"')
+                {
+                    if (pos + 1 < line.size() && line[pos + 1] == '"')
+                    {
+                        str += '"';
+                        pos += 2;
+                        continue;
+                    }
+                    pos++;
+                    break;
+                }
+                str += line[pos++];
+            }
+            fields.emplace_back(std::move(str));
+            pos = std::min(line.find(delimiter, pos), line.size());
+        } else
+        {
+            const size_t next = std::min(line.find(delimiter, pos), line.size());
+            fields.push_back(m_field(line.substr(pos, next - pos)));
+            pos = next;
+        }
+        if (pos == line.size())
+        {
+            return;
+        }
+        pos++;
+    }
+}
+
+DB_variant CCsv_import::m_field(std::string_view field) noexcept
+{
+    const char* first = field.data();
+    const char* last = first + field.size();
+    int i;
+    if (auto [end, ec] = std::from_chars(first, last, i); ec == std::errc() && end == last)
+    {
+        return DB_variant(i);
+    }
+    double d;
+    // from_chars also reads nan and inf, those stay strings as nan would break the key order
+    if (auto [end, ec] = std::from_chars(first, last, d); ec == std::errc() && end == last && std::isfinite(d))
+    {
+        return DB_variant(d);
+    }
+    return DB_variant(std::string(field));
+}
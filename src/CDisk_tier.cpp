@@ -0,0 +1,242 @@
+#include <Mem_DB/CDisk_tier.hpp>
+
+#include <algorithm>
+
+CDisk_tier::CDisk_tier(std::filesystem::path directory, size_t compaction_trigger)
+    :directory(std::move(directory)), trigger(std::max<size_t>(2, compaction_trigger)), mutex(), wake(), runs({}), next_id(0), failed_runs(0), stopping(false), now(0), compactor()
+{
+    std::filesystem::create_directories(this->directory);
+    compactor = std::thread(&CDisk_tier::m_compact_loop, this);
+}
+
+CDisk_tier::~CDisk_tier()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    compactor.join();
+    for (auto& run : runs)
+    {
+        run->Obsolete();
+    }
+}
+
+void CDisk_tier::Flush(const std::vector<item_type>& items)
+{
+    if (items.empty())
+    {
+        return;
+    }
+    CSorted_run::Writer writer(m_next_path(), items.size());
+    for (const auto& item : items)
+    {
+        writer.Add(item);
+    }
+    auto run = writer.Finish();
+    {
+        std::lock_guard lock(mutex);
+        runs.insert(runs.begin(), std::move(run));
+    }
+    wake.notify_all();
+}
+
+std::optional<CDisk_tier::item_type> CDisk_tier::Get(const DB_variant& key) const
+{
+    for (const auto& run : m_snapshot())
+    {
+        if (auto item = run->Get(key))
+        {
+            return item;
+        }
+    }
+    return std::nullopt;
+}
+
+void CDisk_tier::Scan(const DB_variant& low, bool inclusive, const visitor_type& visit) const
+{
+    m_merge(m_snapshot(), &low, inclusive, visit);
+}
+
+size_t CDisk_tier::Runs() const noexcept
+{
+    std::lock_guard lock(mutex);
+    return runs.size();
+}
+
+CDisk_tier::run_list CDisk_tier::m_snapshot() const noexcept
+{
+    std::lock_guard lock(mutex);
+    return runs;
+}
+
+std::string CDisk_tier::m_next_path()
+{
+    std::lock_guard lock(mutex);
+    return (directory / ("run-" + std::to_string(next_id++) + ".sst")).string();
+}
+
+void CDisk_tier::m_merge(const run_list& merged, const DB_variant* low, bool inclusive, const visitor_type& visit)
+{
+    struct Source
+    {
+        CSorted_run::Cursor cursor;
+        item_type item;
+        bool valid;
+    };
+    std::vector<Source> sources;
+    sources.reserve(merged.size());
+    for (const auto& run : merged)
+    {
+        Source source{ low == nullptr ? CSorted_run::Cursor(run, 0) : run->Seek(*low), {}, false };
+        // the sparse index lands up to index_step records before low
+        while ((source.valid = source.cursor.Next(source.item)) && low != nullptr && (source.item.key < *low || (!inclusive && source.item.key == *low)))
+        {
+        }
+        sources.push_back(std::move(source));
+    }
+    // k-way merge, sources are newest first so the first one with the smallest key wins
+    while (true)
+    {
+        Source* smallest = nullptr;
+        for (auto& source : sources)
+        {
+            if (source.valid && (smallest == nullptr || source.item.key < smallest->item.key))
+            {
+                smallest = &source;
+            }
+        }
+        if (smallest == nullptr)
+        {
+            return;
+        }
+        item_type item = std::move(smallest->item);
+        smallest->valid = smallest->cursor.Next(smallest->item);
+        for (auto& source : sources)
+        {
+            while (source.valid && source.item.key == item.key)
+            {
+                source.valid = source.cursor.Next(source.item);
+            }
+        }
+        if (!visit(std::move(item)))
+        {
+            return;
+        }
+    }
+}
+
+std::pair<size_t, size_t> CDisk_tier::m_pick(const run_list& list) const noexcept
+{
+    std::vector<size_t> tiers;
+    tiers.reserve(list.size());
+    for (const auto& run : list)
+    {
+        size_t tier = 0;
+        for (uint64_t limit = tier_base; run->Bytes() > limit; limit *= trigger)
+        {
+            tier++;
+        }
+        tiers.push_back(tier);
+    }
+    // oldest first; smaller runs in between go along, they are cheap and keep newer versions apart from older ones
+    for (size_t i = list.size(); i-- > 0;)
+    {
+        size_t first = i;
+        size_t last = i + 1;
+        while (first > 0 && tiers[first - 1] <= tiers[i])
+        {
+            first--;
+        }
+        while (last < list.size() && tiers[last] <= tiers[i])
+        {
+            last++;
+        }
+        if (static_cast<size_t>(std::count(tiers.begin() + first, tiers.begin() + last, tiers[i])) >= trigger)
+        {
+            return { first, last };
+        }
+    }
+    return { 0, 0 };
+}
+
+void CDisk_tier::m_compact_loop()
+{
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        std::pair<size_t, size_t> picked;
+        wake.wait(lock, [&] {
+            if (stopping)
+            {
+                return true;
+            }
+            picked = runs.size() > failed_runs ? m_pick(runs) : std::pair<size_t, size_t>(0, 0);
+            return picked.first != picked.second;
+            });
+        if (stopping)
+        {
+            return;
+        }
+        // only adjacent runs are merged, so the result takes their place in the age order;
+        // what they shadow in older runs has to stay shadowed unless there is nothing older
+        const run_list merged(runs.begin() + static_cast<std::ptrdiff_t>(picked.first), runs.begin() + static_cast<std::ptrdiff_t>(picked.second));
+        const bool oldest = picked.second == runs.size();
+        const size_t listed = runs.size();
+        lock.unlock();
+
+        const uint64_t tick = now.load(std::memory_order_relaxed);
+        size_t expected = 0;
+        for (const auto& run : merged)
+        {
+            expected += run->size();
+        }
+        std::shared_ptr<CSorted_run> result;
+        try {
+            CSorted_run::Writer writer(m_next_path(), expected);
+            m_merge(merged, nullptr, true, [&](item_type&& item) {
+                if (item.expires == CSorted_run::tombstone || item.expires <= tick)
+                {
+                    if (!oldest)
+                    {
+                        writer.Add({ std::move(item.key), CSorted_run::tombstone, {} });
+                    }
+                    return true;
+                }
+                writer.Add(item);
+                return true;
+                });
+            result = writer.Finish();
+        }
+        catch (std::exception&)
+        {
+            result = nullptr;
+        }
+
+        lock.lock();
+        if (!result)
+        {
+            // disk trouble, wait for another flush before trying again
+            failed_runs = runs.size();
+            continue;
+        }
+        failed_runs = 0;
+        // flushes only prepend, the merged runs moved by as many places
+        const auto first = runs.begin() + static_cast<std::ptrdiff_t>(picked.first + runs.size() - listed);
+        if (result->size() == 0)
+        {
+            // everything expired or was deleted
+            result->Obsolete();
+            runs.erase(first, first + static_cast<std::ptrdiff_t>(merged.size()));
+        } else
+        {
+            *first = std::move(result);
+            runs.erase(first + 1, first + static_cast<std::ptrdiff_t>(merged.size()));
+        }
+        for (const auto& run : merged)
+        {
+            run->Obsolete();
+        }
+    }
+}
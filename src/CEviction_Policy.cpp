@@ -0,0 +1,107 @@
+#include <Mem_DB/CEviction_Policy.hpp>
+
+CEviction_Policy::handle_type CClock_Policy::Add(const DB_variant* key)
+{
+    live++;
+    if (!free.empty())
+    {
+        auto handle = free.back();
+        free.pop_back();
+        keys[handle] = key;
+        referenced[handle] = 1;
+        return handle;
+    }
+    keys.push_back(key);
+    referenced.push_back(1);
+    return keys.size() - 1;
+}
+
+void CClock_Policy::Remove(handle_type handle) noexcept
+{
+    keys[handle] = nullptr;
+    referenced[handle] = 0;
+    free.push_back(handle);
+    live--;
+}
+
+const DB_variant* CClock_Policy::Victim(handle_type keep) noexcept
+{
+    if (live == 0 || (live == 1 && keep != no_handle && keys[keep] != nullptr))
+    {
+        return nullptr;
+    }
+    // after one full turn every reference bit is cleared, so two turns always find a victim
+    for (size_t step = 0; step <= 2 * keys.size(); step++)
+    {
+        size_t current = hand;
+        hand = (hand + 1) % keys.size();
+        if (keys[current] == nullptr || current == keep)
+        {
+            continue;
+        }
+        if (referenced[current])
+        {
+            referenced[current] = 0;
+            continue;
+        }
+        return keys[current];
+    }
+    return nullptr;
+}
+
+CEviction_Policy::handle_type CSampled_LRU_Policy::Add(const DB_variant* key)
+{
+    handle_type handle;
+    if (!free.empty())
+    {
+        handle = free.back();
+        free.pop_back();
+    } else
+    {
+        handle = index.size();
+        index.push_back(0);
+    }
+    index[handle] = slots.size();
+    slots.push_back({ key, ++clock, handle });
+    return handle;
+}
+
+void CSampled_LRU_Policy::Remove(handle_type handle) noexcept
+{
+    size_t i = index[handle];
+    slots[i] = slots.back();
+    index[slots[i].handle] = i;
+    slots.pop_back();
+    free.push_back(handle);
+}
+
+const DB_variant* CSampled_LRU_Policy::Victim(handle_type keep) noexcept
+{
+    const Slot* oldest = nullptr;
+    if (slots.size() <= samples + 1)
+    {
+        for (const auto& slot : slots)
+        {
+            if (slot.handle != keep && (oldest == nullptr || slot.last_access < oldest->last_access))
+            {
+                oldest = &slot;
+            }
+        }
+        return oldest == nullptr ? nullptr : oldest->key;
+    }
+    std::uniform_int_distribution<size_t> pick(0, slots.size() - 1);
+    for (size_t taken = 0; taken < samples;)
+    {
+        const auto& slot = slots[pick(rng)];
+        if (slot.handle == keep)
+        {
+            continue;
+        }
+        taken++;
+        if (oldest == nullptr || slot.last_access < oldest->last_access)
+        {
+            oldest = &slot;
+        }
+    }
+    return oldest == nullptr ? nullptr : oldest->key;
+}
@@ -1,5 +1,9 @@
 #include <Mem_DB/CMemory_Database.hpp>
 
+#include <cmath>
+
+#include <thread>
+
 std::ostream& operator<<(std::ostream& s, const DB_variant_p& var) noexcept
 {
     std::visit(visitors{
@@ -21,18 +25,1342 @@ std::ostream& operator<<(std::ostream& s, const DB_variant& var) noexcept
     return s;
 }
 
+size_t heap_size(const std::string& str) noexcept
+{
+    // short strings live inside the object
+    return str.capacity() > std::string().capacity() ? str.capacity() + 1 : 0;
+}
+
+size_t heap_size(const DB_variant_p& var) noexcept
+{
+    const auto* str = std::get_if<std::string>(&var);
+    return str == nullptr ? 0 : heap_size(*str);
+}
+
+size_t heap_size(const DB_variant& var) noexcept
+{
+    return std::visit(visitors{
+            [](const std::string& str) -> size_t {return heap_size(str);},
+            [](const Pair& p) -> size_t {return p.heapSize();},
+            [](const auto&) -> size_t {return 0;}
+        }, var);
+}
+
+size_t hash_value(const DB_variant_p& var) noexcept
+{
+    return std::hash<DB_variant_p>{}(var);
+}
+
+size_t hash_value(const DB_variant& var) noexcept
+{
+    // the index keeps int 1 and double 1.0 apart
+    return var.index() + 31 * std::visit(visitors{
+            [](const Pair& p) -> size_t {return p.hashValue();},
+            [](const auto& val) -> size_t {return std::hash<std::decay_t<decltype(val)>>{}(val);}
+        }, var);
+}
+
 Result_type CMemory_Database::Find_Value(functor_type func) const noexcept
 {
     Result_type result;
-    for (const auto& [key, values] : base)
-    {
-        for (const auto& value : values)
-        {
+    const bool read = m_visit(m_all_bounds(), [&](const DB_variant& key, const Entry* entry, const CSorted_run::Item* item) {
+        m_for_each_value(entry, item, [&](const DB_variant& value) {
             if (func(key, value))
             {
                 result.add(key, value);
             }
+            });
+        return true;
+        });
+    return read ? result : Result_type(false, 0);
+}
+Result_type CMemory_Database::Top_K(size_t k, const rank& order) const noexcept
+{
+    return m_cached<Result_type>(m_read_key(read_kind::TOP_K, nullptr, static_cast<int>(order), k), write_epoch, [&] {return m_top_k({ m_all_bounds() }, k, order);});
+}
+
+namespace {
+
+// smallest key of every DB_variant alternative, the map keeps alternatives in index order
+DB_variant section_min(size_t index) noexcept
+{
+    switch (index)
+    {
+    case 0:  return DB_variant(std::numeric_limits<int>::min());
+    case 1:  return DB_variant(-std::numeric_limits<double>::infinity());
+    case 2:  return DB_variant(std::string());
+    default: return DB_variant(Pair(std::numeric_limits<int>::min(), std::numeric_limits<int>::min()));
+    }
+}
+
+DB_variant_p section_min_p(size_t index) noexcept
+{
+    switch (index)
+    {
+    case 0:  return DB_variant_p(std::numeric_limits<int>::min());
+    case 1:  return DB_variant_p(-std::numeric_limits<double>::infinity());
+    default: return DB_variant_p(std::string());
+    }
+}
+
+// smallest Pair key with the given first component
+DB_variant pair_min(const DB_variant_p& first) noexcept
+{
+    return DB_variant(Pair(DB_variant_p(first), section_min_p(0)));
+}
+
+// end of the section, none for the last one
+std::optional<DB_variant> section_end(size_t index) noexcept
+{
+    if (index + 1 < std::variant_size_v<DB_variant>)
+    {
+        return section_min(index + 1);
+    }
+    return std::nullopt;
+}
+
+double arithmetic_value(const DB_variant& value) noexcept
+{
+    return std::visit([](auto&& val) -> double {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_arithmetic_v<T>)
+        {
+            return static_cast<double>(val);
+        } else
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        }, value);
+}
+
+}
+
+CMemory_Database::Key_bounds CMemory_Database::m_all_bounds() noexcept
+{
+    return { section_min(0), true, std::nullopt, false };
+}
+
+std::vector<CMemory_Database::Key_bounds> CMemory_Database::m_key_bounds(const DB_variant& key, const operation& op) noexcept
+{
+    using enum operation;
+    // keys equal to probe, greater than it up to the section end or less than it from the section start
+    auto select = [&](std::vector<Key_bounds>& bounds, size_t section, const DB_variant& probe, bool reversed) {
+        const bool greater = op == (reversed ? KEY_LESS : KEY_GREATER);
+        switch (op)
+        {
+        case KEY_EQUALS:
+            bounds.push_back({ probe, true, probe, true });
+            break;
+        case KEY_GREATER:
+        case KEY_LESS:
+            if (greater)
+            {
+                bounds.push_back({ probe, false, section_end(section), false });
+            } else
+            {
+                bounds.push_back({ section_min(section), true, probe, false });
+            }
+            break;
+        default:
+            assert(false && "unreachable");
+        }
+    };
+
+    std::vector<Key_bounds> bounds;
+    std::visit(visitors{
+            [&](const std::string&) {
+                // string and Pair keys are compared as key <=> stored key
+                select(bounds, key.index(), key, true);
+            },
+            [&](const Pair&) {
+                select(bounds, key.index(), key, true);
+            },
+            [&](const auto& number) {
+                // int and double keys are mutually comparable, int section goes first
+                const double k = static_cast<double>(number);
+                if (std::isnan(k))
+                {
+                    return;
+                }
+                constexpr double int_min = std::numeric_limits<int>::min();
+                constexpr double int_max = std::numeric_limits<int>::max();
+                switch (op)
+                {
+                case KEY_EQUALS:
+                    if (k >= int_min && k <= int_max && std::floor(k) == k)
+                    {
+                        select(bounds, 0, DB_variant(static_cast<int>(k)), false);
+                    }
+                    break;
+                case KEY_GREATER:
+                    if (k < int_min)
+                    {
+                        bounds.push_back({ section_min(0), true, section_end(0), false });
+                    } else if (k < int_max)
+                    {
+                        select(bounds, 0, DB_variant(static_cast<int>(std::floor(k))), false);
+                    }
+                    break;
+                case KEY_LESS:
+                    if (k > int_max)
+                    {
+                        bounds.push_back({ section_min(0), true, section_end(0), false });
+                    } else if (k > int_min)
+                    {
+                        select(bounds, 0, DB_variant(static_cast<int>(std::ceil(k))), false);
+                    }
+                    break;
+                default:
+                    assert(false && "unreachable");
+                }
+                select(bounds, 1, DB_variant(k), false);
+            }
+        }, key);
+    return bounds;
+}
+
+std::vector<CMemory_Database::Key_bounds> CMemory_Database::m_pair_bounds(const DB_variant_p& first, const operation& op) noexcept
+{
+    using enum operation;
+    // Pairs are ordered by the first component, so every first component is one contiguous run;
+    // as for Pair keys in Search_Key the probe is compared as probe <=> stored first component
+    auto type_last = [](size_t index) {
+        return index + 1 < std::variant_size_v<DB_variant_p> ? std::optional(pair_min(section_min_p(index + 1))) : std::nullopt;
+    };
+    auto select = [&](std::vector<Key_bounds>& bounds, const DB_variant_p& probe) {
+        const size_t index = probe.index();
+        // seek to the immediate successor of probe instead of walking over the run
+        const auto next = std::visit(visitors{
+                [&](const int& i) {
+                    return i < std::numeric_limits<int>::max() ? std::optional(pair_min(DB_variant_p(i + 1))) : type_last(index);
+                },
+                [&](const double& d) {
+                    if (d == std::numeric_limits<double>::infinity())
+                    {
+                        return type_last(index);
+                    }
+                    return std::optional(pair_min(DB_variant_p(std::nextafter(d, std::numeric_limits<double>::infinity()))));
+                },
+                [&](const std::string& str) {
+                    return std::optional(pair_min(DB_variant_p(str + '\0')));
+                }
+            }, probe);
+        switch (op)
+        {
+        case KEY_EQUALS:
+            bounds.push_back({ pair_min(probe), true, next, false });
+            break;
+        case KEY_GREATER:
+            bounds.push_back({ pair_min(section_min_p(index)), true, pair_min(probe), false });
+            break;
+        case KEY_LESS:
+            if (next)
+            {
+                bounds.push_back({ *next, true, type_last(index), false });
+            }
+            break;
+        default:
+            assert(false && "unreachable");
+        }
+    };
+
+    std::vector<Key_bounds> bounds;
+    std::visit(visitors{
+            [&](const std::string&) {
+                select(bounds, first);
+            },
+            [&](const auto& number) {
+                // int and double first components are mutually comparable, int ones go first
+                const double k = static_cast<double>(number);
+                if (std::isnan(k))
+                {
+                    return;
+                }
+                constexpr double int_min = std::numeric_limits<int>::min();
+                constexpr double int_max = std::numeric_limits<int>::max();
+                const Key_bounds int_run{ pair_min(section_min_p(0)), true, type_last(0), false };
+                switch (op)
+                {
+                case KEY_EQUALS:
+                    if (k >= int_min && k <= int_max && std::floor(k) == k)
+                    {
+                        select(bounds, DB_variant_p(static_cast<int>(k)));
+                    }
+                    break;
+                case KEY_GREATER:
+                    if (k > int_max)
+                    {
+                        bounds.push_back(int_run);
+                    } else if (k > int_min)
+                    {
+                        select(bounds, DB_variant_p(static_cast<int>(std::ceil(k))));
+                    }
+                    break;
+                case KEY_LESS:
+                    if (k < int_min)
+                    {
+                        bounds.push_back(int_run);
+                    } else if (k < int_max)
+                    {
+                        select(bounds, DB_variant_p(static_cast<int>(std::floor(k))));
+                    }
+                    break;
+                default:
+                    assert(false && "unreachable");
+                }
+                select(bounds, DB_variant_p(k));
+            }
+        }, first);
+    return bounds;
+}
+
+std::string CMemory_Database::m_read_key(read_kind read, const DB_variant* key, int op, size_t count, double q) noexcept
+{
+    std::ostringstream s;
+    s.precision(std::numeric_limits<double>::max_digits10);
+    s << static_cast<int>(read) << ':' << op << ':' << count << ':' << q;
+    if (key != nullptr)
+    {
+        s << ':' << key->index() << ':';
+        if (const Pair* pair = std::get_if<Pair>(key); pair != nullptr)
+        {
+            // [1:5] and [1.0:5] print the same, the components need their own index
+            const auto first = pair->getFirst();
+            const auto second = pair->getSecond();
+            s << '[' << first.index() << ':' << first << ':' << second.index() << ':' << second << ']';
+        } else
+        {
+            s << *key;
+        }
+    }
+    return s.str();
+}
+
+uint64_t CMemory_Database::m_epoch(const std::vector<Key_bounds>& bounds) const noexcept
+{
+    // epochs are stamps of one counter, so the newest one in scope stands for all of them
+    uint64_t newest = 0;
+    for (const auto& b : bounds)
+    {
+        if (b.high && b.low_inclusive && b.high_inclusive && *b.high == b.low)
+        {
+            newest = std::max(newest, key_epochs[hash_value(b.low) % epoch_buckets]);
+            continue;
+        }
+        size_t last = b.high ? b.high->index() : section_epochs.size() - 1;
+        if (b.high && last > b.low.index() && !b.high_inclusive && *b.high == section_min(last))
+        {
+            last--;
+        }
+        for (size_t section = b.low.index(); section <= last; section++)
+        {
+            newest = std::max(newest, section_epochs[section]);
+        }
+    }
+    return newest;
+}
+
+void CMemory_Database::m_bump(const DB_variant& key) noexcept
+{
+    ++write_epoch;
+    section_epochs[key.index()] = write_epoch;
+    key_epochs[hash_value(key) % epoch_buckets] = write_epoch;
+}
+
+CMemory_Database::range_type CMemory_Database::m_range(const Key_bounds& bounds) const noexcept
+{
+    if (bounds.high && (*bounds.high < bounds.low || (*bounds.high == bounds.low && !(bounds.low_inclusive && bounds.high_inclusive))))
+    {
+        return { base.end(), base.end() };
+    }
+    auto first = bounds.low_inclusive ? base.lower_bound(bounds.low) : base.upper_bound(bounds.low);
+    auto last = !bounds.high ? base.end() : bounds.high_inclusive ? base.upper_bound(*bounds.high) : base.lower_bound(*bounds.high);
+    return { first, last };
+}
+
+bool CMemory_Database::m_visit(const Key_bounds& bounds, const visitor_type& visit) const noexcept
+{
+    auto [it, last] = m_range(bounds);
+    const auto now = m_now();
+    // memory entries before the given key, false once the visitor stopped
+    auto visit_memory = [&](const DB_variant* until) {
+        for (; it != last && (until == nullptr || it->first < *until); ++it)
+        {
+            if (!m_alive(it->second, now))
+            {
+                continue;
+            }
+            visit_expires = std::min(visit_expires, it->second.expires);
+            if (!visit(it->first, &it->second, nullptr))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (tier)
+    {
+        const bool point = bounds.high && bounds.low_inclusive && bounds.high_inclusive && *bounds.high == bounds.low;
+        bool stopped = false;
+        try
+        {
+            if (point)
+            {
+                // memory shadows the disk, the Bloom filters usually spare the disk reads
+                if (it == last)
+                {
+                    auto item = tier->Get(bounds.low);
+                    if (item && item->expires > now)
+                    {
+                        visit_expires = std::min(visit_expires, item->expires);
+                        visit(item->key, nullptr, &*item);
+                    }
+                    return true;
+                }
+            } else
+            {
+                tier->Scan(bounds.low, bounds.low_inclusive, [&](CSorted_run::Item&& item) {
+                    if (bounds.high && (bounds.high_inclusive ? *bounds.high < item.key : *bounds.high <= item.key))
+                    {
+                        return false;
+                    }
+                    if (!visit_memory(&item.key))
+                    {
+                        stopped = true;
+                        return false;
+                    }
+                    if (it != last && it->first == item.key)
+                    {
+                        return true;
+                    }
+                    if (item.expires <= now)
+                    {
+                        return true;
+                    }
+                    visit_expires = std::min(visit_expires, item.expires);
+                    if (!visit(item.key, nullptr, &item))
+                    {
+                        stopped = true;
+                        return false;
+                    }
+                    return true;
+                    });
+            }
+        } catch (const std::exception&)
+        {
+            // a partial visit would pass for a complete one
+            return false;
+        }
+        if (stopped)
+        {
+            return true;
+        }
+    }
+    visit_memory(nullptr);
+    return true;
+}
+
+Result_type CMemory_Database::m_search(const std::vector<Key_bounds>& bounds, size_t limit) const noexcept
+{
+    Result_type result;
+    for (const auto& b : bounds)
+    {
+        if (result.getLines() >= limit)
+        {
+            break;
+        }
+        const bool read = m_visit(b, [&](const DB_variant& key, const Entry* entry, const CSorted_run::Item* item) {
+            if (entry != nullptr)
+            {
+                m_touch(*entry);
+                result.add(m_record(key, *entry));
+            } else
+            {
+                result.add(Record(key, item->values));
+            }
+            return result.getLines() < limit;
+            });
+        if (!read)
+        {
+            return Result_type(false, 0);
+        }
+    }
+    return result;
+}
+
+Result_type CMemory_Database::m_top_k(const std::vector<Key_bounds>& bounds, size_t k, const rank& order) const noexcept
+{
+    struct Candidate
+    {
+        double rank;
+        // copied, compressed values and disk items exist only while visited
+        DB_variant key;
+        DB_variant value;
+    };
+    // heap top is the worst of the kept candidates, so memory stays O(k)
+    auto beats = [&order](double l, double r) {
+        return order == rank::TOP ? l > r : l < r;
+    };
+    auto better = [&beats](const Candidate& l, const Candidate& r) {
+        return beats(l.rank, r.rank);
+    };
+    std::vector<Candidate> heap;
+    heap.reserve(k);
+    if (k != 0)
+    {
+        for (const auto& b : bounds)
+        {
+            const bool read = m_visit(b, [&](const DB_variant& key, const Entry* entry, const CSorted_run::Item* item) {
+                m_for_each_value(entry, item, [&](const DB_variant& value) {
+                    const double rank = arithmetic_value(value);
+                    if (std::isnan(rank))
+                    {
+                        return;
+                    }
+                    if (heap.size() < k)
+                    {
+                        heap.push_back({ rank, key, value });
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    } else if (beats(rank, heap.front().rank))
+                    {
+                        std::pop_heap(heap.begin(), heap.end(), better);
+                        heap.back() = { rank, key, value };
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    }
+                    });
+                return true;
+                });
+            if (!read)
+            {
+                return Result_type(false, 0);
+            }
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), better);
+    Result_type result;
+    for (const auto& c : heap)
+    {
+        result.add(Record(c.key, c.value));
+    }
+    return result;
+}
+
+void CMemory_Database::m_touch_rows(const Result_type& result) const noexcept
+{
+    if (!policy)
+    {
+        return;
+    }
+    for (const auto& record : result.getRecords())
+    {
+        if (auto it = base.find(record.key); it != base.end())
+        {
+            m_touch(it->second);
+        }
+    }
+}
+
+void CMemory_Database::m_touch_range(const std::vector<Key_bounds>& bounds) const noexcept
+{
+    if (!policy)
+    {
+        return;
+    }
+    const auto now = m_now();
+    for (const auto& b : bounds)
+    {
+        for (auto [it, last] = m_range(b); it != last; ++it)
+        {
+            if (m_alive(it->second, now))
+            {
+                m_touch(it->second);
+            }
+        }
+    }
+}
+
+Aggregate_type CMemory_Database::Aggregate_Values() const noexcept
+{
+    return m_cached<Aggregate_type>(m_read_key(read_kind::AGGREGATE, nullptr, 0), write_epoch, [&] {return m_aggregate({ m_all_bounds() }, false);});
+}
+
+Aggregate_type CMemory_Database::m_aggregate(const std::vector<Key_bounds>& bounds, bool touch) const noexcept
+{
+    Aggregate_type aggregate;
+    for (const auto& b : bounds)
+    {
+        aggregate.valid = m_visit(b, [&](const DB_variant&, const Entry* entry, const CSorted_run::Item* item) {
+            if (touch && entry != nullptr)
+            {
+                m_touch(*entry);
+            }
+            const size_t arithmetic = aggregate.arithmetic_values;
+            m_for_each_value(entry, item, [&](const DB_variant& value) {
+                aggregate.values++;
+                std::visit([&](const auto& val) {
+                    if constexpr (std::is_arithmetic_v<std::decay_t<decltype(val)>>)
+                    {
+                        const double number = static_cast<double>(val);
+                        aggregate.sum += number;
+                        aggregate.min = std::min(aggregate.min, number);
+                        aggregate.max = std::max(aggregate.max, number);
+                        aggregate.arithmetic_values++;
+                    }
+                    }, value);
+                });
+            aggregate.rows++;
+            if (aggregate.arithmetic_values != arithmetic)
+            {
+                aggregate.arithmetic_rows++;
+            }
+            return true;
+            });
+        if (!aggregate.valid)
+        {
+            break;
+        }
+    }
+    return aggregate;
+}
+
+size_t CMemory_Database::Import(const std::filesystem::path& file, char delimiter, size_t threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto batches = CCsv_import(file, delimiter).Parse(threads);
+
+    // k-way merge of the sorted batches, ties go to the earlier batch so values keep the file order
+    using head_type = std::pair<size_t, size_t>;
+    auto later = [&batches](const head_type& l, const head_type& r) {
+        const auto& lk = batches[l.first][l.second].key;
+        const auto& rk = batches[r.first][r.second].key;
+        return rk < lk || (!(lk < rk) && r.first < l.first);
+    };
+    std::vector<head_type> heads;
+    size_t rows = 0;
+    for (size_t i = 0; i < batches.size(); i++)
+    {
+        rows += batches[i].size();
+        if (!batches[i].empty())
+        {
+            heads.emplace_back(i, 0);
+        }
+    }
+    std::make_heap(heads.begin(), heads.end(), later);
+
+    Collect_Expired();
+    // keys come in ascending order, the entry after the previous key is where the next one goes
+    auto last = base.end();
+    auto position = base.begin();
+    while (!heads.empty())
+    {
+        std::pop_heap(heads.begin(), heads.end(), later);
+        auto [batch, index] = heads.back();
+        auto& row = batches[batch][index];
+        if (last == base.end() || last->first != row.key)
+        {
+            if (position != base.end() && position->first < row.key)
+            {
+                position = base.lower_bound(row.key);
+            }
+            last = m_entry(position, std::move(row.key));
+            position = std::next(last);
+        }
+        m_append(last, std::move(row.values));
+        if (memory > budget)
+        {
+            // evicted or spilled keys may include the hint, never the key being filled
+            m_enforce_budget(last);
+            position = std::next(last);
+        }
+        if (++index < batches[batch].size())
+        {
+            heads.back().second = index;
+            std::push_heap(heads.begin(), heads.end(), later);
+        } else
+        {
+            heads.pop_back();
+            // rows already in the map are only moved from shells now
+            batches[batch] = std::vector<CCsv_import::Row>();
+        }
+    }
+    return rows;
+}
+
+double CMemory_Database::Approx_Distinct() const noexcept
+{
+    return m_cached<double>(m_read_key(read_kind::DISTINCT, nullptr, 0), write_epoch, [&] {
+        const auto global = m_global_sketch();
+        return global ? global->Distinct() : std::numeric_limits<double>::quiet_NaN();
+        });
+}
+
+double CMemory_Database::Approx_Quantile(double q) const noexcept
+{
+    return m_cached<double>(m_read_key(read_kind::QUANTILE, nullptr, 0, 0, q), write_epoch, [&] {
+        const auto global = m_global_sketch();
+        return global ? global->Quantile(q) : std::numeric_limits<double>::quiet_NaN();
+        });
+}
+
+const CValue_sketch* CMemory_Database::m_global_sketch() const noexcept
+{
+    // sketches cannot forget a value, one pass over the data clears the removed ones
+    // after enough of them piled up to pay for it
+    if (sketch_removed != 0 && sketch_removed * sketch_rebuild_ratio >= sketch_values)
+    {
+        sketch = CValue_sketch();
+        sketch_values = 0;
+        const bool read = m_visit(m_all_bounds(), [&](const DB_variant&, const Entry* entry, const CSorted_run::Item* item) {
+            m_for_each_value(entry, item, [&](const DB_variant& value) {
+                sketch.Add(value);
+                sketch_values++;
+                });
+            return true;
+            });
+        if (!read)
+        {
+            // no values counted, so the next read rebuilds it again
+            sketch_values = 0;
+            return nullptr;
+        }
+        sketch_removed = 0;
+    }
+    return &sketch;
+}
+
+std::optional<CValue_sketch> CMemory_Database::m_sketch(const std::vector<Key_bounds>& bounds) const noexcept
+{
+    // small keys are cheaper to add value by value than to keep a sketch for
+    CValue_sketch merged(key_sketch_precision, key_sketch_k);
+    for (const auto& b : bounds)
+    {
+        const bool read = m_visit(b, [&](const DB_variant&, const Entry* entry, const CSorted_run::Item* item) {
+            if (entry != nullptr && entry->sketch)
+            {
+                merged.Merge(*entry->sketch);
+                return true;
+            }
+            m_for_each_value(entry, item, [&](const DB_variant& value) {merged.Add(value);});
+            return true;
+            });
+        if (!read)
+        {
+            return std::nullopt;
+        }
+    }
+    return merged;
+}
+
+void CMemory_Database::m_sketch_add(Entry& entry, size_t first) noexcept
+{
+    for (size_t i = first; i < entry.values.size(); i++)
+    {
+        sketch.Add(entry.values[i]);
+    }
+    sketch_values += entry.values.size() - first;
+    if (entry.sketch)
+    {
+        for (size_t i = first; i < entry.values.size(); i++)
+        {
+            entry.sketch->Add(entry.values[i]);
+        }
+    } else if (entry.values.size() >= key_sketch_threshold)
+    {
+        // the new values are among all of them, none goes in twice
+        entry.sketch = std::make_unique<CValue_sketch>(key_sketch_precision, key_sketch_k);
+        for (const auto& value : entry.values)
+        {
+            entry.sketch->Add(value);
+        }
+    }
+}
+
+void CMemory_Database::Set_Memory_Budget(size_t bytes) noexcept
+{
+    budget = bytes;
+    if (budget != no_limit && !policy)
+    {
+        Set_Eviction_Policy(std::make_unique<CClock_Policy>());
+    }
+    m_enforce_budget(base.end());
+}
+
+bool CMemory_Database::Set_Disk_Tier(std::unique_ptr<CDisk_tier> new_tier) noexcept
+{
+    // keys spilled to the old tier would be lost
+    if (tier || !new_tier)
+    {
+        return false;
+    }
+    tier = std::move(new_tier);
+    tier->Advance(m_now());
+    m_enforce_budget(base.end());
+    return true;
+}
+
+void CMemory_Database::Set_Eviction_Policy(std::unique_ptr<CEviction_Policy> new_policy) noexcept
+{
+    policy = std::move(new_policy);
+    for (auto& [key, entry] : base)
+    {
+        entry.handle = policy ? policy->Add(&key) : CEviction_Policy::no_handle;
+    }
+}
+
+size_t CMemory_Database::m_entry_size(const DB_variant& key, const Entry& entry) const noexcept
+{
+    // red-black tree node: color, parent, left and right next to the stored pair
+    constexpr size_t node_size = sizeof(base_type::value_type) + 4 * sizeof(void*);
+    const size_t compressed = entry.compressed ? entry.compressed->Memory_Usage() : 0;
+    const size_t sketch = entry.sketch ? entry.sketch->Memory_Usage() : 0;
+    return node_size + heap_size(key) + entry.values.capacity() * sizeof(DB_variant) + entry.heap + compressed + sketch;
+}
+
+CMemory_Database::base_type::iterator CMemory_Database::m_find(base_type::iterator it, const DB_variant& key) noexcept
+{
+    if (it != base.end() && it->first == key)
+    {
+        m_touch(it->second);
+        return it;
+    }
+    if (!tier)
+    {
+        return base.end();
+    }
+    std::optional<CSorted_run::Item> item;
+    try
+    {
+        item = tier->Get(key);
+    } catch (const std::exception&)
+    {
+        return base.end();
+    }
+    if (!item || item->expires <= m_now())
+    {
+        return base.end();
+    }
+    // spilled key is read back, its rows in the queries are already there
+    it = base.emplace_hint(it, std::move(item->key), Entry());
+    auto& entry = it->second;
+    entry.on_disk = true;
+    entry.expires = item->expires;
+    entry.values = std::move(item->values);
+    for (const auto& value : entry.values)
+    {
+        entry.heap += heap_size(value);
+    }
+    if (entry.expires != no_expiry)
+    {
+        timers.Schedule(entry.expires, it->first);
+    }
+    if (policy)
+    {
+        entry.handle = policy->Add(&it->first);
+    }
+    memory += m_entry_size(it->first, entry);
+    return it;
+}
+
+CMemory_Database::base_type::iterator CMemory_Database::m_entry(base_type::iterator position, DB_variant&& key) noexcept
+{
+    auto it = m_find(position, key);
+    if (it != base.end())
+    {
+        return it;
+    }
+    it = base.emplace_hint(position, std::move(key), Entry());
+    if (policy)
+    {
+        it->second.handle = policy->Add(&it->first);
+    }
+    memory += m_entry_size(it->first, it->second);
+    m_bump(it->first);
+    m_query_add(it);
+    return it;
+}
+
+void CMemory_Database::m_push(base_type::iterator it, DB_variant&& value) noexcept
+{
+    m_decompress(it);
+    auto& entry = it->second;
+    entry.written = true;
+    memory -= m_entry_size(it->first, entry);
+    entry.heap += heap_size(value);
+    entry.values.push_back(std::move(value));
+    m_sketch_add(entry, entry.values.size() - 1);
+    memory += m_entry_size(it->first, entry);
+    m_bump(it->first);
+    m_query_push(it, entry.values.back());
+}
+
+void CMemory_Database::m_append(base_type::iterator it, std::vector<DB_variant>&& values) noexcept
+{
+    // m_push for many values, the entry is accounted for once
+    m_decompress(it);
+    auto& entry = it->second;
+    entry.written = true;
+    memory -= m_entry_size(it->first, entry);
+    const size_t first = entry.values.size();
+    if (first == 0)
+    {
+        entry.values = std::move(values);
+    } else
+    {
+        entry.values.insert(entry.values.end(), std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+    }
+    for (size_t i = first; i < entry.values.size(); i++)
+    {
+        entry.heap += heap_size(entry.values[i]);
+    }
+    m_sketch_add(entry, first);
+    memory += m_entry_size(it->first, entry);
+    m_bump(it->first);
+    if (!queries.empty())
+    {
+        for (size_t i = first; i < entry.values.size(); i++)
+        {
+            m_query_push(it, entry.values[i]);
+        }
+    }
+}
+
+void CMemory_Database::m_remove(base_type::iterator it, const DB_variant& value) noexcept
+{
+    m_decompress(it);
+    auto& entry = it->second;
+    entry.written = true;
+    // capacity is unchanged, only the removed strings are released;
+    // their capacity may differ from the one of value, and std::remove leaves moved from ones behind
+    size_t freed = 0;
+    for (const auto& stored : entry.values)
+    {
+        freed += stored == value ? heap_size(stored) : 0;
+    }
+    auto removed = std::remove(entry.values.begin(), entry.values.end(), value);
+    const size_t count = static_cast<size_t>(std::distance(removed, entry.values.end()));
+    entry.values.erase(removed, entry.values.end());
+    entry.heap -= freed;
+    memory -= freed;
+    if (count != 0)
+    {
+        m_bump(it->first);
+        m_sketch_remove(count);
+        if (entry.sketch)
+        {
+            memory -= entry.sketch->Memory_Usage();
+            entry.sketch.reset();
+        }
+        m_query_remove(it, value);
+    }
+}
+
+void CMemory_Database::m_clear(base_type::iterator it) noexcept
+{
+    m_query_erase(it->first, true);
+    auto& entry = it->second;
+    entry.written = true;
+    memory -= m_entry_size(it->first, entry);
+    m_sketch_remove(m_value_count(entry));
+    entry.values = std::vector<DB_variant>();
+    entry.heap = 0;
+    entry.compressed.reset();
+    entry.sketch.reset();
+    memory += m_entry_size(it->first, entry);
+    m_bump(it->first);
+}
+
+void CMemory_Database::m_erase(base_type::iterator it, bool spilled) noexcept
+{
+    if (!spilled)
+    {
+        m_query_erase(it->first, false);
+        m_sketch_remove(m_value_count(it->second));
+        m_bump(it->first);
+    }
+    memory -= m_entry_size(it->first, it->second);
+    if (policy && it->second.handle != CEviction_Policy::no_handle)
+    {
+        policy->Remove(it->second.handle);
+    }
+    base.erase(it);
+}
+
+void CMemory_Database::m_spill(base_type::iterator keep) noexcept
+{
+    // one run per spill, so the victims are collected down to a bit below the budget
+    const size_t target = budget - budget / 10;
+    const auto keep_handle = keep == base.end() ? CEviction_Policy::no_handle : keep->second.handle;
+    std::vector<base_type::iterator> victims;
+    size_t freed = 0;
+    while (memory - freed > target)
+    {
+        const DB_variant* victim = policy->Victim(keep_handle);
+        if (victim == nullptr)
+        {
+            break;
+        }
+        auto it = base.find(*victim);
+        // picked victims leave the policy right away, so they are not picked twice
+        policy->Remove(it->second.handle);
+        it->second.handle = CEviction_Policy::no_handle;
+        freed += m_entry_size(it->first, it->second);
+        victims.push_back(it);
+    }
+    if (victims.empty())
+    {
+        return;
+    }
+    std::sort(victims.begin(), victims.end(), [](const auto& l, const auto& r) {return l->first < r->first;});
+    try
+    {
+        std::vector<CSorted_run::Item> items;
+        items.reserve(victims.size());
+        for (const auto& it : victims)
+        {
+            const auto& entry = it->second;
+            items.push_back({ it->first, entry.expires, entry.compressed ? entry.compressed->Decode() : entry.values });
+        }
+        tier->Flush(items);
+    } catch (const std::exception&)
+    {
+        // nothing was spilled, the keys stay in memory over the budget
+        for (const auto& it : victims)
+        {
+            it->second.handle = policy->Add(&it->first);
+        }
+        return;
+    }
+    for (const auto& it : victims)
+    {
+        m_erase(it, true);
+    }
+}
+
+void CMemory_Database::m_enforce_budget(base_type::iterator keep) noexcept
+{
+    if (budget == no_limit || !policy)
+    {
+        return;
+    }
+    if (tier)
+    {
+        if (memory > budget)
+        {
+            m_spill(keep);
+        }
+        return;
+    }
+    const auto keep_handle = keep == base.end() ? CEviction_Policy::no_handle : keep->second.handle;
+    while (memory > budget)
+    {
+        const DB_variant* victim = policy->Victim(keep_handle);
+        if (victim == nullptr)
+        {
+            return;
+        }
+        m_erase(base.find(*victim));
+    }
+}
+
+size_t CMemory_Database::Collect_Expired() noexcept
+{
+    size_t removed = 0;
+    std::vector<CSorted_run::Item> tombstones;
+    const auto now = m_now();
+    if (tier)
+    {
+        // compaction drops what expired on disk
+        tier->Advance(now);
+    }
+    timers.Advance(now, [&](CTimer_Wheel::Timer&& timer) {
+        auto it = base.find(timer.key);
+        // the key may have been evicted, recreated or given another time to live since
+        if (it != base.end() && it->second.expires == timer.deadline)
+        {
+            if (it->second.on_disk)
+            {
+                // older version in the tier would come back otherwise
+                tombstones.push_back({ it->first, CSorted_run::tombstone, {} });
+            }
+            m_erase(it);
+            removed++;
+        } else if (it == base.end() && tier)
+        {
+            // a spilled key may have expired, reads skip it from now on
+            m_query_erase(timer.key, false);
+            // its values are not read back just to count them
+            m_sketch_remove(1);
+            m_bump(timer.key);
         }
+        });
+    if (!tombstones.empty())
+    {
+        std::sort(tombstones.begin(), tombstones.end(), [](const auto& l, const auto& r) {return l.key < r.key;});
+        try
+        {
+            tier->Flush(tombstones);
+        } catch (const std::exception&)
+        {
+            // the older versions carry their own expiry
+        }
+    }
+    return removed;
+}
+
+Result_type CMemory_Database::m_expire(const DB_variant& key, std::chrono::milliseconds ttl) noexcept
+{
+    auto it = m_find(key);
+    if (it == base.end() || !m_alive(it->second, m_now()))
+    {
+        return Result_type(false, 0);
     }
+    const auto deadline = m_now() + static_cast<CTimer_Wheel::tick_type>(std::max<std::chrono::milliseconds::rep>(ttl.count(), 0));
+    it->second.expires = deadline;
+    timers.Schedule(deadline, it->first);
+    m_bump(it->first);
+    m_query_expire(it);
+    Result_type result;
+    result.add(m_record(it->first, it->second));
     return result;
-}
\ No newline at end of file
+}
+
+size_t CMemory_Database::Compress(bool cold_only) noexcept
+{
+    size_t count = 0;
+    for (auto& [key, entry] : base)
+    {
+        const bool cold = !entry.written;
+        entry.written = false;
+        if (entry.compressed || entry.values.size() < compression_threshold || (cold_only && !cold))
+        {
+            continue;
+        }
+        const size_t plain = m_entry_size(key, entry);
+        auto compressed = std::make_unique<CCompressed_values>(entry.values);
+        // mostly Pairs or unique long strings do not get any smaller
+        if (compressed->Memory_Usage() >= entry.values.capacity() * sizeof(DB_variant) + entry.heap)
+        {
+            continue;
+        }
+        entry.compressed = std::move(compressed);
+        entry.values = std::vector<DB_variant>();
+        entry.heap = 0;
+        memory -= plain;
+        memory += m_entry_size(key, entry);
+        count++;
+    }
+    return count;
+}
+
+void CMemory_Database::m_decompress(base_type::iterator it) noexcept
+{
+    auto& entry = it->second;
+    if (!entry.compressed)
+    {
+        return;
+    }
+    memory -= m_entry_size(it->first, entry);
+    entry.values = entry.compressed->Decode();
+    entry.compressed.reset();
+    entry.heap = 0;
+    for (const auto& value : entry.values)
+    {
+        entry.heap += heap_size(value);
+    }
+    memory += m_entry_size(it->first, entry);
+}
+
+CMemory_Database::query_id CMemory_Database::Register_Query(functor_type func) noexcept
+{
+    return m_register(Query{ false, DB_variant(), operation::KEY_EQUALS, std::move(func), {}, {} });
+}
+
+bool CMemory_Database::Unregister_Query(query_id id) noexcept
+{
+    return queries.erase(id) != 0;
+}
+
+Result_type CMemory_Database::Query_Result(query_id id) const noexcept
+{
+    auto query = queries.find(id);
+    if (query == queries.end())
+    {
+        return Result_type(false, 0);
+    }
+    Result_type result;
+    const auto now = m_now();
+    for (const auto& [key, row] : query->second.rows)
+    {
+        if (row.expires > now)
+        {
+            result.add(Record(key, row.values));
+        }
+    }
+    return result;
+}
+
+bool CMemory_Database::Subscribe(query_id id, subscriber_type subscriber) noexcept
+{
+    auto query = queries.find(id);
+    if (query == queries.end())
+    {
+        return false;
+    }
+    query->second.subscribers.push_back(std::move(subscriber));
+    return true;
+}
+
+CMemory_Database::query_id CMemory_Database::m_register(Query&& query) noexcept
+{
+    // the only full scan, from now on the result follows the writes
+    auto add = [&](const DB_variant& key, CTimer_Wheel::tick_type expires, const Entry* entry, const CSorted_run::Item* item) {
+        if (query.by_key)
+        {
+            auto& row = query.rows[key];
+            row.expires = expires;
+            m_for_each_value(entry, item, [&](const DB_variant& value) {row.values.push_back(value);});
+            return;
+        }
+        m_for_each_value(entry, item, [&](const DB_variant& value) {
+            if (query.func(key, value))
+            {
+                auto& row = query.rows[key];
+                row.expires = expires;
+                row.values.push_back(value);
+            }
+            });
+    };
+    auto visit = [&](const DB_variant& key, const Entry* entry, const CSorted_run::Item* item) {
+        add(key, entry != nullptr ? entry->expires : item->expires, entry, item);
+        return true;
+    };
+    for (const auto& bounds : query.by_key ? m_key_bounds(query.key, query.op) : std::vector{ m_all_bounds() })
+    {
+        if (!m_visit(bounds, visit))
+        {
+            return no_query;
+        }
+    }
+    const query_id id = next_query++;
+    queries.emplace(id, std::move(query));
+    return id;
+}
+
+bool CMemory_Database::m_query_matches(const Query& query, const DB_variant& key) const noexcept
+{
+    // same comparisons as m_key_bounds selects for Search_Key
+    return std::visit([&](const auto& stored, const auto& probe) {
+        using S = std::decay_t<decltype(stored)>;
+        using P = std::decay_t<decltype(probe)>;
+        if constexpr (std::is_arithmetic_v<S> && std::is_arithmetic_v<P>)
+        {
+            return compare(static_cast<double>(stored) <=> static_cast<double>(probe), query.op);
+        } else if constexpr (std::same_as<S, P>)
+        {
+            return compare(probe <=> stored, query.op);
+        } else
+        {
+            return false;
+        }
+        }, key, query.key);
+}
+
+namespace {
+
+void notify(const std::vector<CMemory_Database::subscriber_type>& subscribers, const CMemory_Database::Change& change)
+{
+    for (const auto& subscriber : subscribers)
+    {
+        subscriber(change);
+    }
+}
+
+}
+
+void CMemory_Database::m_query_add(base_type::iterator it) noexcept
+{
+    for (auto& [id, query] : queries)
+    {
+        if (query.by_key && m_query_matches(query, it->first))
+        {
+            query.rows[it->first].expires = it->second.expires;
+        }
+    }
+}
+
+void CMemory_Database::m_query_push(base_type::iterator it, const DB_variant& value) noexcept
+{
+    for (auto& [id, query] : queries)
+    {
+        if (query.by_key ? !query.rows.contains(it->first) : !query.func(it->first, value))
+        {
+            continue;
+        }
+        auto& row = query.rows[it->first];
+        row.expires = it->second.expires;
+        row.values.push_back(value);
+        notify(query.subscribers, { change_kind::ADDED, it->first, value });
+    }
+}
+
+void CMemory_Database::m_query_remove(base_type::iterator it, const DB_variant& value) noexcept
+{
+    for (auto& [id, query] : queries)
+    {
+        auto row = query.rows.find(it->first);
+        if (row == query.rows.end())
+        {
+            continue;
+        }
+        auto& values = row->second.values;
+        auto removed = std::remove(values.begin(), values.end(), value);
+        const auto count = std::distance(removed, values.end());
+        values.erase(removed, values.end());
+        for (auto i = 0; i < count; i++)
+        {
+            notify(query.subscribers, { change_kind::REMOVED, it->first, value });
+        }
+        if (!query.by_key && values.empty())
+        {
+            query.rows.erase(row);
+        }
+    }
+}
+
+void CMemory_Database::m_query_erase(const DB_variant& key, bool keep_key) noexcept
+{
+    for (auto& [id, query] : queries)
+    {
+        auto row = query.rows.find(key);
+        if (row == query.rows.end())
+        {
+            continue;
+        }
+        for (const auto& value : row->second.values)
+        {
+            notify(query.subscribers, { change_kind::REMOVED, key, value });
+        }
+        if (keep_key && query.by_key)
+        {
+            row->second.values = std::vector<DB_variant>();
+        } else
+        {
+            query.rows.erase(row);
+        }
+    }
+}
+
+void CMemory_Database::m_query_expire(base_type::iterator it) noexcept
+{
+    for (auto& [id, query] : queries)
+    {
+        auto row = query.rows.find(it->first);
+        if (row != query.rows.end())
+        {
+            row->second.expires = it->second.expires;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#include <Mem_DB/CResult_cache.hpp>
+
+#include <utility>
+
+const CResult_cache::value_type* CResult_cache::Get(const std::string& read, uint64_t epoch, uint64_t now) noexcept
+{
+    auto found = index.find(read);
+    if (found == index.end())
+    {
+        misses++;
+        return nullptr;
+    }
+    auto it = found->second;
+    if (it->epoch != epoch || it->valid_until <= now)
+    {
+        // a write or an expiry changed the result since, the entry would never hit again
+        m_erase(it);
+        misses++;
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it);
+    hits++;
+    return &it->result;
+}
+
+void CResult_cache::Put(std::string read, uint64_t epoch, uint64_t valid_until, value_type result) noexcept
+{
+    if (auto found = index.find(read); found != index.end())
+    {
+        m_erase(found->second);
+    }
+    // list node, index node, the read and the result
+    constexpr size_t overhead = sizeof(Cached) + 2 * sizeof(void*) + sizeof(std::string_view) + 3 * sizeof(void*);
+    const size_t size = overhead + read.capacity() + std::visit(visitors{
+            [](const Result_type& r) {return r.Memory_Usage() - sizeof(Result_type);},
+            [](const auto&) -> size_t {return 0;}
+        }, result);
+    if (size > capacity)
+    {
+        return;
+    }
+    m_shrink(capacity - size);
+    entries.push_front({ std::move(read), epoch, valid_until, std::move(result), size });
+    // the key views the read stored in the list node, which never moves
+    index.emplace(entries.front().read, entries.begin());
+    used += size;
+}
+
+void CResult_cache::Set_Capacity(size_t bytes) noexcept
+{
+    capacity = bytes;
+    m_shrink(capacity);
+}
+
+void CResult_cache::Clear() noexcept
+{
+    index.clear();
+    entries.clear();
+    used = 0;
+}
+
+void CResult_cache::m_erase(std::list<Cached>::iterator it) noexcept
+{
+    used -= it->size;
+    index.erase(it->read);
+    entries.erase(it);
+}
+
+void CResult_cache::m_shrink(size_t limit) noexcept
+{
+    while (used > limit)
+    {
+        m_erase(std::prev(entries.end()));
+    }
+}
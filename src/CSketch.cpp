@@ -0,0 +1,214 @@
+#include <Mem_DB/CSketch.hpp>
+#include <Mem_DB/sys_util.hpp>
+
+#include <cmath>
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <utility>
+
+CHyper_log_log::CHyper_log_log(unsigned precision) noexcept
+    :precision(std::clamp(precision, 4u, 18u)), registers(size_t(1) << this->precision, 0)
+{
+}
+
+void CHyper_log_log::Add(uint64_t hash) noexcept
+{
+    // first precision bits pick the register, it keeps the longest run of leading zeros of the rest
+    const size_t index = hash >> (64 - precision);
+    const uint64_t rest = hash << precision;
+    const uint8_t rank = static_cast<uint8_t>(std::min<unsigned>(std::countl_zero(rest), 64 - precision) + 1);
+    registers[index] = std::max(registers[index], rank);
+}
+
+bool CHyper_log_log::Merge(const CHyper_log_log& other) noexcept
+{
+    if (other.precision != precision)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < registers.size(); i++)
+    {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+    return true;
+}
+
+double CHyper_log_log::Estimate() const noexcept
+{
+    const double m = static_cast<double>(registers.size());
+    double sum = 0;
+    size_t zeros = 0;
+    for (const auto reg : registers)
+    {
+        sum += std::ldexp(1.0, -reg);
+        zeros += reg == 0;
+    }
+    double alpha;
+    switch (registers.size())
+    {
+    case 16: alpha = 0.673; break;
+    case 32: alpha = 0.697; break;
+    case 64: alpha = 0.709; break;
+    default: alpha = 0.7213 / (1 + 1.079 / m);
+    }
+    const double estimate = alpha * m * m / sum;
+    // linear counting is more precise while many registers are empty
+    if (estimate <= 2.5 * m && zeros != 0)
+    {
+        return m * std::log(m / static_cast<double>(zeros));
+    }
+    return estimate;
+}
+
+CKLL_sketch::CKLL_sketch(size_t k) noexcept
+    :k(std::max<size_t>(k, 8)), count(0), retained(0), capacity(0), coin(0x9e3779b97f4a7c15ULL), levels({})
+{
+    m_grow();
+}
+
+void CKLL_sketch::m_grow() noexcept
+{
+    levels.emplace_back();
+    capacity = 0;
+    for (size_t h = 0; h < levels.size(); h++)
+    {
+        capacity += m_capacity(h);
+    }
+}
+
+size_t CKLL_sketch::m_capacity(size_t level) const noexcept
+{
+    // lower levels shrink geometrically, the top one holds k items
+    const size_t depth = levels.size() - level - 1;
+    return std::max<size_t>(2, static_cast<size_t>(std::ceil(static_cast<double>(k) * std::pow(2.0 / 3.0, static_cast<double>(depth)))));
+}
+
+void CKLL_sketch::Add(double value) noexcept
+{
+    if (std::isnan(value))
+    {
+        return;
+    }
+    levels[0].push_back(value);
+    retained++;
+    count++;
+    if (retained > capacity)
+    {
+        m_compress();
+    }
+}
+
+void CKLL_sketch::Merge(const CKLL_sketch& other) noexcept
+{
+    while (levels.size() < other.levels.size())
+    {
+        m_grow();
+    }
+    for (size_t h = 0; h < other.levels.size(); h++)
+    {
+        levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+    }
+    retained += other.retained;
+    count += other.count;
+    m_compress();
+}
+
+void CKLL_sketch::m_compress() noexcept
+{
+    while (retained > capacity)
+    {
+        for (size_t h = 0; h < levels.size(); h++)
+        {
+            if (levels[h].size() < m_capacity(h))
+            {
+                continue;
+            }
+            if (h + 1 == levels.size())
+            {
+                m_grow();
+            }
+            auto& level = levels[h];
+            std::sort(level.begin(), level.end());
+            // an odd item out stays, every other of the rest goes up with double weight
+            const size_t odd = level.size() % 2;
+            coin ^= coin << 13;
+            coin ^= coin >> 7;
+            coin ^= coin << 17;
+            const size_t offset = coin & 1;
+            auto& up = levels[h + 1];
+            for (size_t i = odd + offset; i < level.size(); i += 2)
+            {
+                up.push_back(level[i]);
+            }
+            const size_t compacted = level.size() - odd;
+            level.resize(odd);
+            retained -= compacted / 2;
+            break;
+        }
+    }
+}
+
+double CKLL_sketch::Quantile(double q) const noexcept
+{
+    if (count == 0 || std::isnan(q))
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    std::vector<std::pair<double, uint64_t>> weighted;
+    weighted.reserve(retained);
+    uint64_t total = 0;
+    for (size_t h = 0; h < levels.size(); h++)
+    {
+        for (const auto value : levels[h])
+        {
+            weighted.emplace_back(value, uint64_t(1) << h);
+            total += uint64_t(1) << h;
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+    const double target = std::clamp(q, 0.0, 1.0) * static_cast<double>(total);
+    uint64_t seen = 0;
+    for (const auto& [value, weight] : weighted)
+    {
+        seen += weight;
+        if (static_cast<double>(seen) >= target)
+        {
+            return value;
+        }
+    }
+    return weighted.back().first;
+}
+
+size_t CKLL_sketch::Memory_Usage() const noexcept
+{
+    size_t bytes = levels.capacity() * sizeof(std::vector<double>);
+    for (const auto& level : levels)
+    {
+        bytes += level.capacity() * sizeof(double);
+    }
+    return bytes;
+}
+
+void CValue_sketch::Add(const DB_variant& value) noexcept
+{
+    distinct.Add(mix_hash(hash_value(value)));
+    if (const int* i = std::get_if<int>(&value); i != nullptr)
+    {
+        quantiles.Add(*i);
+    } else if (const double* d = std::get_if<double>(&value); d != nullptr)
+    {
+        quantiles.Add(*d);
+    }
+}
+
+bool CValue_sketch::Merge(const CValue_sketch& other) noexcept
+{
+    if (!distinct.Merge(other.distinct))
+    {
+        return false;
+    }
+    quantiles.Merge(other.quantiles);
+    return true;
+}
@@ -0,0 +1,331 @@
+#include <Mem_DB/CSorted_run.hpp>
+#include <Mem_DB/sys_util.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t write_buffer = 1024 * 1024;
+constexpr size_t read_chunk = 64 * 1024;
+
+template<typename T>
+void put(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void put_string(std::string& out, const std::string& str)
+{
+    put(out, static_cast<uint32_t>(str.size()));
+    out.append(str);
+}
+
+void put_variant_p(std::string& out, const DB_variant_p& var)
+{
+    put(out, static_cast<uint8_t>(var.index()));
+    std::visit(visitors{
+            [&](const int& i) {put(out, i);},
+            [&](const double& d) {put(out, d);},
+            [&](const std::string& str) {put_string(out, str);}
+        }, var);
+}
+
+void put_variant(std::string& out, const DB_variant& var)
+{
+    put(out, static_cast<uint8_t>(var.index()));
+    std::visit(visitors{
+            [&](const int& i) {put(out, i);},
+            [&](const double& d) {put(out, d);},
+            [&](const std::string& str) {put_string(out, str);},
+            [&](const Pair& p) {
+                put_variant_p(out, p.getFirst());
+                put_variant_p(out, p.getSecond());
+            }
+        }, var);
+}
+
+// reads from a record already known to be complete
+class Record_reader
+{
+public:
+    explicit Record_reader(const char* data) noexcept :data(data) {};
+
+    template<typename T>
+    T get() noexcept
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+        return value;
+    }
+
+    std::string get_string()
+    {
+        const auto size = get<uint32_t>();
+        std::string str(data, size);
+        data += size;
+        return str;
+    }
+
+    DB_variant_p get_variant_p()
+    {
+        switch (get<uint8_t>())
+        {
+        case 0:  return DB_variant_p(get<int>());
+        case 1:  return DB_variant_p(get<double>());
+        default: return DB_variant_p(get_string());
+        }
+    }
+
+    DB_variant get_variant()
+    {
+        switch (get<uint8_t>())
+        {
+        case 0:  return DB_variant(get<int>());
+        case 1:  return DB_variant(get<double>());
+        case 2:  return DB_variant(get_string());
+        default:
+        {
+            auto first = get_variant_p();
+            auto second = get_variant_p();
+            return DB_variant(Pair(std::move(first), std::move(second)));
+        }
+        }
+    }
+
+private:
+    const char* data;
+};
+
+}
+
+CBloom_filter::CBloom_filter(size_t keys, size_t bits_per_key) noexcept
+    :bits(std::max<size_t>(1, (keys * bits_per_key + 63) / 64), 0),
+    // k = ln 2 * bits per key is optimal
+    hashes(std::clamp<size_t>(bits_per_key * 69 / 100, 1, 30))
+{
+}
+
+void CBloom_filter::Add(uint64_t hash) noexcept
+{
+    const uint64_t h1 = mix_hash(hash);
+    const uint64_t h2 = (h1 >> 32) | 1;
+    const uint64_t size = bits.size() * 64;
+    for (size_t i = 0; i < hashes; i++)
+    {
+        const uint64_t bit = (h1 + i * h2) % size;
+        bits[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool CBloom_filter::May_Contain(uint64_t hash) const noexcept
+{
+    const uint64_t h1 = mix_hash(hash);
+    const uint64_t h2 = (h1 >> 32) | 1;
+    const uint64_t size = bits.size() * 64;
+    for (size_t i = 0; i < hashes; i++)
+    {
+        const uint64_t bit = (h1 + i * h2) % size;
+        if (!(bits[bit / 64] & (uint64_t(1) << (bit % 64))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+CSorted_run::CSorted_run(std::string path, size_t expected_items)
+    :path(std::move(path)), fd(-1), file_size(0), count(0), obsolete(false), bloom(expected_items), index({})
+{
+    fd = open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd == -1)
+    {
+        throw sys_error("open " + this->path);
+    }
+}
+
+CSorted_run::~CSorted_run()
+{
+    if (fd != -1)
+    {
+        close(fd);
+    }
+    if (obsolete)
+    {
+        unlink(path.c_str());
+    }
+}
+
+std::optional<CSorted_run::Item> CSorted_run::Get(const DB_variant& key) const
+{
+    if (!bloom.May_Contain(hash_value(key)))
+    {
+        return std::nullopt;
+    }
+    auto cursor = Seek(key);
+    Item item;
+    while (cursor.Next(item))
+    {
+        if (item.key == key)
+        {
+            return item;
+        }
+        if (key < item.key)
+        {
+            break;
+        }
+    }
+    return std::nullopt;
+}
+
+CSorted_run::Cursor CSorted_run::Seek(const DB_variant& key) const
+{
+    auto it = std::upper_bound(index.begin(), index.end(), key, [](const DB_variant& k, const auto& entry) {return k < entry.first;});
+    const uint64_t offset = it == index.begin() ? 0 : std::prev(it)->second;
+    return Cursor(shared_from_this(), offset);
+}
+
+CSorted_run::Writer::Writer(std::string path, size_t expected_items)
+    :run(new CSorted_run(std::move(path), expected_items)), buffer({}), offset(0)
+{
+    buffer.reserve(write_buffer);
+    run->index.reserve(expected_items / index_step + 1);
+}
+
+CSorted_run::Writer::~Writer()
+{
+    // unfinished run is removed with its file
+    if (run)
+    {
+        run->Obsolete();
+    }
+}
+
+void CSorted_run::Writer::Add(const Item& item)
+{
+    if (run->count % index_step == 0)
+    {
+        run->index.emplace_back(item.key, offset);
+    }
+    run->bloom.Add(hash_value(item.key));
+    run->count++;
+
+    const size_t start = buffer.size();
+    put(buffer, uint32_t(0));
+    put_variant(buffer, item.key);
+    put(buffer, item.expires);
+    put(buffer, static_cast<uint32_t>(item.values.size()));
+    for (const auto& value : item.values)
+    {
+        put_variant(buffer, value);
+    }
+    const auto length = static_cast<uint32_t>(buffer.size() - start - sizeof(uint32_t));
+    std::memcpy(buffer.data() + start, &length, sizeof(length));
+    offset += buffer.size() - start;
+    if (buffer.size() >= write_buffer)
+    {
+        m_flush();
+    }
+}
+
+std::shared_ptr<CSorted_run> CSorted_run::Writer::Finish()
+{
+    m_flush();
+    run->file_size = offset;
+    run->index.shrink_to_fit();
+    return std::move(run);
+}
+
+void CSorted_run::Writer::m_flush()
+{
+    size_t written = 0;
+    while (written < buffer.size())
+    {
+        ssize_t n = write(run->fd, buffer.data() + written, buffer.size() - written);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw sys_error("write " + run->path);
+        }
+        written += static_cast<size_t>(n);
+    }
+    buffer.clear();
+}
+
+bool CSorted_run::Cursor::Next(Item& item)
+{
+    if (!m_fill(sizeof(uint32_t)))
+    {
+        return false;
+    }
+    uint32_t length;
+    std::memcpy(&length, buffer.data() + position, sizeof(length));
+    if (!m_fill(sizeof(uint32_t) + length))
+    {
+        return false;
+    }
+    Record_reader reader(buffer.data() + position + sizeof(uint32_t));
+    item.key = reader.get_variant();
+    item.expires = reader.get<uint64_t>();
+    const auto count = reader.get<uint32_t>();
+    item.values.clear();
+    item.values.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        item.values.push_back(reader.get_variant());
+    }
+    position += sizeof(uint32_t) + length;
+    return true;
+}
+
+bool CSorted_run::Cursor::m_fill(size_t bytes)
+{
+    if (buffer.size() - position >= bytes)
+    {
+        return true;
+    }
+    buffer.erase(0, position);
+    position = 0;
+    while (buffer.size() < bytes && offset < run->file_size)
+    {
+        const size_t want = std::max(read_chunk, bytes - buffer.size());
+        const size_t start = buffer.size();
+        buffer.resize(start + want);
+        ssize_t n = pread(run->fd, buffer.data() + start, want, static_cast<off_t>(offset));
+        if (n <= 0)
+        {
+            buffer.resize(start);
+            if (n == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n == -1)
+            {
+                throw sys_error("read " + run->path);
+            }
+            break;
+        }
+        buffer.resize(start + static_cast<size_t>(n));
+        offset += static_cast<uint64_t>(n);
+    }
+    if (buffer.size() >= bytes)
+    {
+        return true;
+    }
+    // the end of the run falls only between records
+    if (!buffer.empty() || offset < run->file_size)
+    {
+        throw std::runtime_error("Run " + run->path + " is truncated!");
+    }
+    return false;
+}
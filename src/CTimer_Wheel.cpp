@@ -0,0 +1,88 @@
+#include <Mem_DB/CTimer_Wheel.hpp>
+
+void CTimer_Wheel::Schedule(tick_type deadline, const DB_variant& key)
+{
+    count++;
+    if (deadline <= current)
+    {
+        due.push_back({ deadline, key });
+        return;
+    }
+    m_place({ deadline, key });
+}
+
+void CTimer_Wheel::Advance(tick_type now, const expired_type& expired)
+{
+    auto fire = [&](slot_type& slot) {
+        slot_type fired;
+        fired.swap(slot);
+        count -= fired.size();
+        for (auto& timer : fired)
+        {
+            expired(std::move(timer));
+        }
+    };
+
+    fire(due);
+    if (count == 0 && now > current)
+    {
+        current = now;
+        return;
+    }
+    while (current < now)
+    {
+        current++;
+        const size_t index = current & (slots - 1);
+        if (index == 0)
+        {
+            m_cascade(1);
+        }
+        fire(levels[0][index]);
+        if (count == 0)
+        {
+            current = now;
+        }
+    }
+}
+
+void CTimer_Wheel::m_place(Timer&& timer)
+{
+    if (timer.deadline <= current)
+    {
+        // due at the current tick, which is fired right after the cascade
+        levels[0][current & (slots - 1)].push_back(std::move(timer));
+        return;
+    }
+    const tick_type delta = timer.deadline - current;
+    for (size_t level = 0; level < level_count; level++)
+    {
+        if (delta < (tick_type(1) << (slot_bits * (level + 1))))
+        {
+            const size_t index = (timer.deadline >> (slot_bits * level)) & (slots - 1);
+            levels[level][index].push_back(std::move(timer));
+            return;
+        }
+    }
+    overflow.push_back(std::move(timer));
+}
+
+void CTimer_Wheel::m_cascade(size_t level)
+{
+    slot_type moved;
+    if (level == level_count)
+    {
+        moved.swap(overflow);
+    } else
+    {
+        const size_t index = (current >> (slot_bits * level)) & (slots - 1);
+        if (index == 0)
+        {
+            m_cascade(level + 1);
+        }
+        moved.swap(levels[level][index]);
+    }
+    for (auto& timer : moved)
+    {
+        m_place(std::move(timer));
+    }
+}
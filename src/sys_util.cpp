@@ -0,0 +1,20 @@
+#include <Mem_DB/sys_util.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+uint64_t mix_hash(uint64_t x) noexcept
+{
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+std::runtime_error sys_error(const std::string& what)
+{
+    return std::runtime_error(what + " error:" + strerror(errno));
+}
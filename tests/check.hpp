@@ -0,0 +1,15 @@
+#pragma once
+
+#include <iostream>
+
+// checks of the test programs, unlike assert they stay on in release builds
+inline int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            failures++; \
+        } \
+    } while (false)
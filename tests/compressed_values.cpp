@@ -0,0 +1,80 @@
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Mem_DB/CCompressed_values.hpp>
+
+#include "check.hpp"
+
+namespace {
+
+constexpr int int_min = std::numeric_limits<int>::min();
+constexpr int int_max = std::numeric_limits<int>::max();
+
+// Decode and For_Each have to give back the values in their order and type
+void check_round_trip(const std::vector<DB_variant>& values)
+{
+    const CCompressed_values compressed(values);
+    CHECK(compressed.size() == values.size());
+    CHECK(compressed.Decode() == values);
+    std::vector<DB_variant> streamed;
+    compressed.For_Each([&](const DB_variant& value) {streamed.push_back(value);});
+    CHECK(streamed == values);
+}
+
+}
+
+int main()
+{
+    check_round_trip({});
+    check_round_trip({ DB_variant(0) });
+
+    // deltas of the int extremes do not fit into int
+    check_round_trip({ DB_variant(int_min), DB_variant(int_max), DB_variant(int_min), DB_variant(int_max) });
+    check_round_trip({ DB_variant(int_max), DB_variant(int_min), DB_variant(0), DB_variant(-1), DB_variant(int_max), DB_variant(int_max) });
+
+    // int runs longer than a block, with small deltas and with extreme ones
+    std::vector<DB_variant> ints;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> any(int_min, int_max);
+    for (int i = 0; i < 1000; i++)
+    {
+        ints.emplace_back(i % 300 == 0 ? any(rng) : i);
+    }
+    for (int i = 0; i < 300; i++)
+    {
+        ints.emplace_back(i % 2 == 0 ? int_min : int_max);
+    }
+    check_round_trip(ints);
+
+    // repeated strings go through the dictionary, the empty one included
+    std::vector<DB_variant> strings;
+    const std::vector<std::string> words = { "", "a", "word", "a longer string than the short string buffer", "word " };
+    for (size_t i = 0; i < 700; i++)
+    {
+        strings.emplace_back(words[(i * 7) % words.size()]);
+    }
+    check_round_trip(strings);
+    check_round_trip({ DB_variant(std::string("only")) });
+
+    // doubles and Pairs are stored as they are
+    check_round_trip({ DB_variant(-0.0), DB_variant(1.5), DB_variant(std::numeric_limits<double>::infinity()), DB_variant(std::numeric_limits<double>::lowest()) });
+    check_round_trip({ DB_variant(Pair(1, std::string("x"))), DB_variant(Pair(2.5, int_min)) });
+
+    // runs switching type, across block boundaries
+    std::vector<DB_variant> mixed;
+    for (int i = 0; i < 1000; i++)
+    {
+        switch ((i / 37) % 4)
+        {
+        case 0:  mixed.emplace_back(i % 5 == 0 ? int_min : i); break;
+        case 1:  mixed.emplace_back(i * 0.25); break;
+        case 2:  mixed.emplace_back(words[static_cast<size_t>(i) % words.size()]); break;
+        default: mixed.emplace_back(Pair(i, i)); break;
+        }
+    }
+    check_round_trip(mixed);
+
+    return failures == 0 ? 0 : 1;
+}
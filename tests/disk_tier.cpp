@@ -0,0 +1,181 @@
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <Mem_DB/CDisk_tier.hpp>
+#include <Mem_DB/CSorted_run.hpp>
+
+#include "check.hpp"
+
+namespace {
+
+using Item = CSorted_run::Item;
+
+constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+const std::filesystem::path directory = std::filesystem::temp_directory_path() / ("Mem_DB_test_" + std::to_string(getpid()));
+
+void check_bloom_filter()
+{
+    CBloom_filter bloom(1000);
+    for (uint64_t hash = 0; hash < 1000; hash++)
+    {
+        bloom.Add(hash);
+    }
+    size_t missing = 0;
+    for (uint64_t hash = 0; hash < 1000; hash++)
+    {
+        missing += bloom.May_Contain(hash) ? 0 : 1;
+    }
+    CHECK(missing == 0);
+    // 10 bits per key give about 1 % false positives
+    size_t false_positives = 0;
+    for (uint64_t hash = 1000; hash < 101000; hash++)
+    {
+        false_positives += bloom.May_Contain(hash) ? 1 : 0;
+    }
+    CHECK(false_positives < 3000);
+}
+
+void check_sorted_run()
+{
+    // even ints, then doubles, strings and Pairs, the order of DB_variant
+    std::vector<Item> items;
+    for (int i = 0; i < 1000; i += 2)
+    {
+        items.push_back({ DB_variant(i), static_cast<uint64_t>(i) + 1, { DB_variant(i), DB_variant(std::to_string(i)) } });
+    }
+    items.push_back({ DB_variant(0.5), never, { DB_variant(0.5) } });
+    items.push_back({ DB_variant(std::string("key")), CSorted_run::tombstone, {} });
+    items.push_back({ DB_variant(Pair(1, 2)), never, { DB_variant(Pair(3, 4)) } });
+
+    CSorted_run::Writer writer((directory / "run.sst").string(), items.size());
+    for (const auto& item : items)
+    {
+        writer.Add(item);
+    }
+    const auto run = writer.Finish();
+    CHECK(run->size() == items.size());
+
+    for (const auto& item : items)
+    {
+        const auto found = run->Get(item.key);
+        CHECK(found && found->key == item.key && found->expires == item.expires && found->values == item.values);
+    }
+    for (int i = -1; i <= 1001; i += 2)
+    {
+        CHECK(!run->Get(DB_variant(i)));
+    }
+    CHECK(!run->Get(DB_variant(1.0)));
+    CHECK(!run->Get(DB_variant(std::string("kez"))));
+    CHECK(!run->Get(DB_variant(Pair(1, 3))));
+
+    // the sparse index lands at most index_step records before the key
+    for (size_t i = 0; i < items.size(); i += 7)
+    {
+        auto cursor = run->Seek(items[i].key);
+        Item item;
+        size_t skipped = 0;
+        while (cursor.Next(item) && item.key < items[i].key)
+        {
+            skipped++;
+        }
+        CHECK(item.key == items[i].key);
+        CHECK(skipped < CSorted_run::index_step);
+    }
+    // a key between two records starts at the next one
+    auto cursor = run->Seek(DB_variant(501));
+    Item item;
+    while (cursor.Next(item) && item.key < DB_variant(501))
+    {
+    }
+    CHECK(item.key == DB_variant(502));
+    run->Obsolete();
+}
+
+// waits for the background compaction to get the tier down to the given number of runs
+bool wait_for_runs(const CDisk_tier& tier, size_t runs)
+{
+    for (int i = 0; i < 500 && tier.Runs() != runs; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return tier.Runs() == runs;
+}
+
+void check_tier()
+{
+    // four runs of the lowest size tier are merged, three are not
+    CDisk_tier tier(directory / "tier", 4);
+    tier.Advance(100);
+    const DB_variant key(7);
+    const DB_variant kept(8);
+    const DB_variant expired(9);
+    // the key is overwritten, then deleted, each version in its own run
+    tier.Flush({ { key, never, { DB_variant(1) } }, { kept, never, { DB_variant(8) } }, { expired, 50, { DB_variant(9) } } });
+    tier.Flush({ { key, never, { DB_variant(1), DB_variant(2) } } });
+    CHECK(tier.Get(key) && tier.Get(key)->values == std::vector<DB_variant>({ DB_variant(1), DB_variant(2) }));
+    tier.Flush({ { key, CSorted_run::tombstone, {} } });
+    CHECK(tier.Runs() == 3);
+
+    auto check_versions = [&]() {
+        const auto deleted = tier.Get(key);
+        CHECK(!deleted || deleted->expires == CSorted_run::tombstone);
+        const auto found = tier.Get(kept);
+        CHECK(found && found->values == std::vector<DB_variant>({ DB_variant(8) }));
+        // newest version of every int key once, in key order
+        std::vector<DB_variant> live;
+        tier.Scan(DB_variant(0), true, [&](Item&& item) {
+            if (std::holds_alternative<int>(item.key) && item.expires != CSorted_run::tombstone && item.expires > 100)
+            {
+                live.push_back(item.key);
+            }
+            return true;
+            });
+        CHECK(live == std::vector<DB_variant>({ kept }));
+    };
+    check_versions();
+
+    tier.Flush({ { DB_variant(std::string("other")), never, {} } });
+    CHECK(wait_for_runs(tier, 1));
+    check_versions();
+    // all runs were merged, so neither the tombstone nor the expired item is kept
+    CHECK(!tier.Get(key));
+    CHECK(!tier.Get(expired));
+
+    // a run larger than the lowest size tier stays out of the merge of the small ones after it,
+    // so the merged tombstone has to keep shadowing the version in it
+    CDisk_tier tiers(directory / "tiers", 4);
+    std::vector<Item> large;
+    for (int i = 0; i < 10000; i++)
+    {
+        large.push_back({ DB_variant(i), never, { DB_variant(std::string(16, 'x')) } });
+    }
+    tiers.Flush(large);
+    tiers.Flush({ { key, CSorted_run::tombstone, {} } });
+    for (int i = 0; i < 3; i++)
+    {
+        tiers.Flush({ { DB_variant(20000 + i), never, {} } });
+    }
+    CHECK(wait_for_runs(tiers, 2));
+    const auto shadowed = tiers.Get(key);
+    CHECK(shadowed && shadowed->expires == CSorted_run::tombstone);
+    CHECK(tiers.Get(DB_variant(6)) && tiers.Get(DB_variant(20002)));
+}
+
+}
+
+int main()
+{
+    std::filesystem::create_directories(directory);
+    check_bloom_filter();
+    check_sorted_run();
+    check_tier();
+    std::filesystem::remove_all(directory);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#include <map>
+#include <vector>
+
+#include <Mem_DB/CTimer_Wheel.hpp>
+
+#include "check.hpp"
+
+namespace {
+
+using tick_type = CTimer_Wheel::tick_type;
+
+// level 0 covers 64 ticks and every next level 64 times more, deadlines past 64^4 overflow
+constexpr tick_type level_1 = 64;
+constexpr tick_type level_2 = 64 * 64;
+constexpr tick_type overflow = 64 * 64 * 64 * 64;
+
+// schedules the deadlines and advances in the given steps, every timer has to fire
+// exactly once, at the first Advance that reaches its deadline
+void check_wheel(tick_type start, const std::vector<tick_type>& deadlines, const std::vector<tick_type>& steps)
+{
+    CTimer_Wheel wheel;
+    wheel.Advance(start, [](CTimer_Wheel::Timer&&) {});
+    for (size_t i = 0; i < deadlines.size(); i++)
+    {
+        wheel.Schedule(deadlines[i], DB_variant(static_cast<int>(i)));
+    }
+    CHECK(wheel.size() == deadlines.size());
+
+    std::map<int, tick_type> fired;
+    tick_type previous = start;
+    tick_type now = start;
+    for (const auto step : steps)
+    {
+        now += step;
+        wheel.Advance(now, [&](CTimer_Wheel::Timer&& timer) {
+            const int i = std::get<int>(timer.key);
+            CHECK(fired.count(i) == 0);
+            CHECK(timer.deadline == deadlines[static_cast<size_t>(i)]);
+            // not early and not later than the Advance that passed the deadline
+            CHECK(timer.deadline <= now);
+            CHECK(timer.deadline > previous || timer.deadline <= start);
+            fired[i] = now;
+            });
+        CHECK(wheel.Now() == now);
+        previous = now;
+    }
+    CHECK(fired.size() == deadlines.size());
+    CHECK(wheel.size() == 0);
+}
+
+}
+
+int main()
+{
+    const std::vector<tick_type> boundaries = {
+        1, 2, level_1 - 1, level_1, level_1 + 1, 2 * level_1 - 1, 2 * level_1,
+        level_2 - 1, level_2, level_2 + 1, overflow - 1, overflow, overflow + 1
+    };
+
+    // one tick at a time across the level 0 and level 1 boundaries
+    check_wheel(0, { 1, 2, level_1 - 1, level_1, level_1 + 1, 2 * level_1, level_2 - 1, level_2, level_2 + 1 }, std::vector<tick_type>(level_2 + 2, 1));
+    // jumps that land on, before and after the slot boundaries, up to past the overflow
+    check_wheel(0, boundaries, { level_1 - 1, 1, 1, level_2 - 2 * level_1, level_1, overflow - level_2, 1, 1, 100 });
+    // a start in the middle of a slot, so deadlines are not aligned with the wheel
+    std::vector<tick_type> shifted;
+    for (const auto deadline : boundaries)
+    {
+        shifted.push_back(deadline + 1000);
+    }
+    check_wheel(1000, shifted, { 1, 62, 1, 5000, overflow - 5064, 1, 1 });
+    // deadlines already due when scheduled fire on the next Advance
+    check_wheel(500, { 0, 499, 500, 501 }, { 0, 1 });
+    // one Advance past everything
+    check_wheel(0, boundaries, { 2 * overflow });
+
+    return failures == 0 ? 0 : 1;
+}